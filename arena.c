@@ -0,0 +1,111 @@
+/*
+ * This file is part of ltrace.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+/* Smallest block that the arena allocates.  */
+#define ARENA_BLOCK_SIZE 1024
+
+union arena_align {
+	long l;
+	long long ll;
+	double d;
+	long double ld;
+	void *p;
+};
+
+#define ARENA_ALIGN (sizeof(union arena_align))
+
+struct arena_block
+{
+	struct arena_block *next;
+	size_t size;
+	union arena_align data[];
+};
+
+void
+arena_init(struct arena *arena)
+{
+	memset(arena, 0, sizeof(*arena));
+}
+
+void *
+arena_alloc(struct arena *arena, size_t size)
+{
+	size = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+	if (size == 0)
+		size = ARENA_ALIGN;
+
+	struct arena_block *block = arena->blocks;
+	if (block == NULL || block->size - arena->used < size) {
+		size_t bsize = arena->hint;
+		if (bsize < ARENA_BLOCK_SIZE)
+			bsize = ARENA_BLOCK_SIZE;
+		if (block != NULL && bsize < 2 * block->size)
+			bsize = 2 * block->size;
+		if (bsize < size)
+			bsize = size;
+
+		block = malloc(sizeof(*block) + bsize);
+		if (block == NULL)
+			return NULL;
+		block->size = bsize;
+		block->next = arena->blocks;
+		arena->blocks = block;
+		arena->used = 0;
+	}
+
+	void *ret = (char *)block->data + arena->used;
+	arena->used += size;
+	return ret;
+}
+
+void
+arena_reset(struct arena *arena)
+{
+	struct arena_block *block = arena->blocks;
+	if (block == NULL || block->next == NULL) {
+		arena->used = 0;
+		return;
+	}
+
+	/* Several blocks were needed.  Replace them by a single one,
+	 * allocated on next use, that fits all of it.  */
+	size_t total = 0;
+	while (block != NULL) {
+		struct arena_block *next = block->next;
+		total += block->size;
+		free(block);
+		block = next;
+	}
+	arena->blocks = NULL;
+	arena->used = 0;
+	arena->hint = total;
+}
+
+void
+arena_destroy(struct arena *arena)
+{
+	arena_reset(arena);
+	free(arena->blocks);
+	arena_init(arena);
+}
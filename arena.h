@@ -0,0 +1,56 @@
+/*
+ * This file is part of ltrace.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Arena is a bump allocator for memory that all becomes unused at
+ * the same time.  Allocations can't be freed one by one, the whole
+ * arena is reset instead.  After a reset, the arena keeps a single
+ * block large enough for everything that was allocated before it, so
+ * an arena that is used over and over for similar work soon stops
+ * calling malloc altogether.
+ *
+ * An arena that is all zeroes is initialized and empty.  */
+
+struct arena_block;
+
+struct arena
+{
+	struct arena_block *blocks;
+	size_t used;		/* In bytes, of the first block.  */
+	size_t hint;		/* Size of the next block to allocate.  */
+};
+
+/* Initialize ARENA.  */
+void arena_init(struct arena *arena);
+
+/* Allocate SIZE bytes from ARENA, aligned suitably for any type.
+ * Returns NULL on failure.  */
+void *arena_alloc(struct arena *arena, size_t size);
+
+/* Release everything that was allocated from ARENA.  */
+void arena_reset(struct arena *arena);
+
+/* Destroy ARENA and free all its memory.  */
+void arena_destroy(struct arena *arena);
+
+#endif /* ARENA_H */
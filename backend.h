@@ -148,6 +148,20 @@ void continue_after_breakpoint(struct process *proc, struct breakpoint *sbp);
  * imagine other systems may be different.  */
 void continue_after_vfork(struct process *proc);
 
+/* Hand the newly forked process PROC, which is stopped, over to a
+ * freshly forked copy of ltrace, so that each process is traced by
+ * its own tracer.  Returns 0 in the original tracer, where PROC has
+ * been removed, 1 in the new tracer, where PROC was continued and all
+ * other processes have been removed, or a negative value on failure,
+ * in which case nothing has changed.  */
+int split_tracer(struct process *proc);
+
+/* Check whether split_tracer can work at all.  The new tracer is not
+ * an ancestor of the process that it takes over, and the system may
+ * not allow that.  Returns 0 if it can work, or a negative value,
+ * after telling the user why, if it can't.  */
+int os_check_split_tracers(void);
+
 /* Called after the process exec's.  Should do whatever book-keeping
  * is necessary and then continue the process.  */
 void continue_after_exec(struct process *proc);
@@ -173,10 +187,43 @@ void trace_fail_warning(pid_t pid);
 int os_ltrace_exiting_sighandler(void);
 void os_ltrace_exiting(void);
 
+/* Ask the event loop to call CB when file descriptor FD becomes
+ * readable.  CB is called with FD and DATA as arguments, from the
+ * main loop, and only when there are no tracing events ready to be
+ * handled.  The descriptor stays owned by the caller, who has to
+ * call OS_UNWATCH_FD before closing it.  Returns 0 on success or a
+ * negative value on failure.
+ *
+ * Watched descriptors are not carried over to tracers created by
+ * --split-tracers.  */
+int os_watch_fd(int fd, void (*cb)(int fd, void *data), void *data);
+void os_unwatch_fd(int fd);
+
+/* Ask the event loop to call CB every INTERVAL_MS milliseconds, with
+ * DATA as argument.  Like with OS_WATCH_FD, CB is only called when
+ * no tracing events are ready, so the calls may be late, but they
+ * are never made more often than requested.  Timers keep running in
+ * tracers created by --split-tracers.  Returns 0 on success or a
+ * negative value on failure.  */
+int os_add_timer(unsigned interval_ms, void (*cb)(void *data), void *data);
+
 /* Should copy COUNT bytes from address ADDR of process PROC to local
  * buffer BUF.  */
 size_t umovebytes(struct process *proc, void *addr, void *buf, size_t count);
 
+/* Answer whether the LEN bytes at ADDR are mapped in the address
+ * space of PROC.  Returns 1 if they are, 0 if they are not, or a
+ * negative value if that can't be determined.  This is used to
+ * avoid reading through pointers that can't be valid, and is meant
+ * to be much cheaper than the failed read.  */
+int os_address_mapped(struct process *proc, arch_addr_t addr, size_t len);
+
+/* Called when task PROC returns from the system call called NAME, or
+ * NULL if the name is not known.  This lets the backend notice calls
+ * that change the address space that os_address_mapped answers
+ * about.  */
+void os_process_sysret(struct process *proc, const char *name);
+
 /* Find out an address of symbol SYM in process PROC, and return.
  * Returning NULL delays breakpoint insertion and enables heaps of
  * arch-specific black magic that we should clean up some day.
@@ -268,6 +315,13 @@ void arch_process_destroy(struct process *proc);
 int arch_process_clone(struct process *retp, struct process *proc);
 int arch_process_exec(struct process *proc);
 
+/* The following callback has to be implemented in backend if arch.h
+ * defines ARCH_HAVE_TYPE_DATA.  INFO->arch is zeroed when the type is
+ * initialized.  arch_type_destroy is called to release it when the
+ * type is destroyed, or changed such that the data may no longer
+ * apply, after which INFO->arch is zeroed again.  */
+void arch_type_destroy(struct arg_type_info *info);
+
 /* The following callbacks have to be implemented in OS backend if
  * os.h defines OS_HAVE_PROCESS_DATA.  The protocol is same as for,
  * respectively, arch_process_init, arch_process_destroy,
@@ -344,6 +398,49 @@ int arch_find_dl_debug(struct process *proc, arch_addr_t dyn_addr,
  * implemented: arch_fetch_param_pack_start,
  * arch_fetch_param_pack_end.  See fetch.h for details.  */
 
+/* The following callback has to be implemented in backend if arch.h
+ * defines ARCH_HAVE_EMULATE_BREAKPOINT.
+ *
+ * This is called when PROC is to be continued after hitting the
+ * breakpoint BP, before resorting to temporarily removing the
+ * breakpoint and singlestepping over it, which requires that all
+ * other tasks of the process be stopped.  If the instruction
+ * under BP can be emulated, arch_emulate_breakpoint should apply its
+ * effect to registers and memory of PROC, leave the instruction
+ * pointer after it, and return 0.  It also returns 0 for breakpoints
+ * realized by hardware, which don't need stepping over.  Otherwise
+ * it returns a negative value, and should leave PROC intact.  */
+int arch_emulate_breakpoint(struct process *proc, struct breakpoint *bp);
+
+/* The following callbacks have to be implemented in backend if
+ * arch.h defines ARCH_HAVE_HW_BREAKPOINTS.
+ *
+ * arch_hw_breakpoint_promote is called when all tasks of LEADER are
+ * stopped, and BP, which is not currently in memory, was stepped over
+ * often enough that it should rather be realized by hardware.  If
+ * that's done in all tasks of LEADER, it returns 0, and BP is left
+ * out of memory.  Later arch_emulate_breakpoint is expected to let
+ * tasks continue from BP.  Otherwise it returns a negative value.
+ *
+ * arch_hw_breakpoint_hit is called when TASK stops with SIGTRAP.  If
+ * that was caused by a hardware breakpoint, it stores the address of
+ * that breakpoint to *ADDRP and returns 1.  Otherwise it returns 0.
+ *
+ * arch_hw_breakpoint_p answers whether BP was moved to hardware by
+ * arch_hw_breakpoint_promote.  Such breakpoints are never put back
+ * to memory.  When they are destroyed, the backend is expected to
+ * release the hardware in all tasks of the process.
+ *
+ * arch_hw_breakpoints_enable realizes hardware breakpoints of the
+ * leader of TASK in TASK, which is a new stopped task.
+ * arch_hw_breakpoints_disable removes them from the stopped TASK,
+ * which is about to be detached.  */
+int arch_hw_breakpoint_promote(struct process *leader, struct breakpoint *bp);
+int arch_hw_breakpoint_hit(struct process *task, arch_addr_t *addrp);
+int arch_hw_breakpoint_p(struct breakpoint *bp);
+void arch_hw_breakpoints_enable(struct process *task);
+void arch_hw_breakpoints_disable(struct process *task);
+
 enum sw_singlestep_status {
 	SWS_FAIL,
 	SWS_OK,
@@ -55,6 +55,8 @@ struct breakpoint {
 	void *addr;
 	unsigned char orig_value[BREAKPOINT_LENGTH];
 	int enabled;
+	unsigned stepovers;	/* How many times it was stepped over.  */
+	int muted;		/* Turned off through the control socket.  */
 	struct arch_breakpoint_data arch;
 };
 
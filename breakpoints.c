@@ -124,6 +124,8 @@ breakpoint_init_base(struct breakpoint *bp, struct process *proc,
 	bp->addr = addr;
 	memset(bp->orig_value, 0, sizeof(bp->orig_value));
 	bp->enabled = 0;
+	bp->stepovers = 0;
+	bp->muted = 0;
 	bp->libsym = libsym;
 }
 
@@ -168,6 +170,7 @@ breakpoint_clone(struct breakpoint *retp, struct process *new_proc,
 	breakpoint_init_base(retp, new_proc, bp->addr, libsym);
 	memcpy(retp->orig_value, bp->orig_value, sizeof(bp->orig_value));
 	retp->enabled = bp->enabled;
+	retp->muted = bp->muted;
 	if (arch_breakpoint_clone(retp, bp) < 0)
 		return -1;
 	breakpoint_set_callbacks(retp, bp->cbs);
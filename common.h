@@ -84,6 +84,9 @@ extern pid_t execute_program(const char * command, char ** argv);
 
 extern void show_summary(void);
 
+/* Free statistics gathered for -c so far.  */
+extern void drop_summary(void);
+
 struct breakpoint;
 struct library_symbol;
 
@@ -0,0 +1,516 @@
+/*
+ * This file is part of ltrace.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#define _GNU_SOURCE /* For accept4.  */
+#include "config.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "breakpoint.h"
+#include "common.h"
+#include "control.h"
+#include "filter.h"
+#include "library.h"
+#include "proc.h"
+
+struct control_rule {
+	struct control_rule *next;
+	struct filter *filter;
+	char *expr;
+	int enable;
+};
+
+static struct control_rule *rules = NULL;
+static unsigned generation = 0;
+
+/* Values of breakpoint->muted.  */
+enum {
+	MUTED_NOT = 0,
+	MUTED_ONLY,	/* Hits are ignored.  */
+	MUTED_OFF,	/* Also turned off by us.  */
+};
+
+struct control_client {
+	int fd;
+	size_t len;
+	char buf[256];
+};
+
+static const char *control_path = NULL;
+static pid_t control_pid;
+
+/* State of the tracing window, see control_window_init.  */
+static enum {
+	WINDOW_NONE,	/* No window was requested.  */
+	WINDOW_CLOSED,
+	WINDOW_OPEN,
+} window = WINDOW_NONE;
+static struct timespec window_opened;
+static int window_calls;
+
+/* How often, in milliseconds, is --stop-after checked.  */
+#define WINDOW_TICK 50
+
+static int
+window_trigger(struct library_symbol *libsym)
+{
+	return options.start_filter != NULL
+		&& filter_matches_symbol(options.start_filter,
+					 libsym->name, libsym->lib);
+}
+
+static int
+symbol_muted(struct library_symbol *libsym)
+{
+	/* Only the trigger stays armed outside of the window.  */
+	if (window == WINDOW_CLOSED)
+		return !window_trigger(libsym);
+
+	int muted = 0;
+	struct control_rule *it;
+	for (it = rules; it != NULL; it = it->next)
+		if (filter_matches_symbol(it->filter, libsym->name,
+					  libsym->lib))
+			muted = !it->enable;
+	return muted;
+}
+
+static enum callback_status
+apply_rules_cb(struct process *leader, struct breakpoint *bp, void *data)
+{
+	if (bp->libsym == NULL)
+		return CBS_CONT;
+
+	int muted = symbol_muted(bp->libsym);
+	if (muted && bp->muted == MUTED_NOT) {
+		/* A breakpoint that was moved to a debug register
+		 * keeps firing even turned off, so with
+		 * --hw-breakpoints, the hits are just ignored.  */
+		bp->muted = MUTED_ONLY;
+		if (bp->enabled > 0 && !options.hw_breakpoints
+		    && breakpoint_turn_off(bp, leader) == 0)
+			bp->muted = MUTED_OFF;
+
+	} else if (!muted && bp->muted != MUTED_NOT) {
+		if (bp->muted == MUTED_OFF
+		    && breakpoint_turn_on(bp, leader) < 0)
+			fprintf(stderr, "Couldn't turn on breakpoint %s@%p\n",
+				breakpoint_name(bp), bp->addr);
+		bp->muted = MUTED_NOT;
+	}
+	return CBS_CONT;
+}
+
+void
+control_apply(struct process *task)
+{
+	if (generation == 0 || task == NULL)
+		return;
+
+	/* Don't get in the way of a breakpoint being stepped
+	 * over.  */
+	struct process *leader = task->leader;
+	if (leader == NULL || leader->control_applied == generation
+	    || leader->event_handler != NULL
+	    || task->state != STATE_ATTACHED)
+		return;
+
+	debug(DEBUG_PROCESS, "control_apply: pid=%d, generation %u",
+	      leader->pid, generation);
+	proc_each_breakpoint(leader, NULL, &apply_rules_cb, NULL);
+	leader->control_applied = generation;
+}
+
+static void
+new_generation(void)
+{
+	/* Zero means that no rules were ever given.  */
+	if (++generation == 0)
+		generation = 1;
+}
+
+/* Open or close the tracing window.  TASK, if non-NULL, is stopped,
+ * and its process is updated right away.  */
+static void
+set_window(struct process *task, int open)
+{
+	debug(DEBUG_PROCESS, "control: tracing window %s",
+	      open ? "opened" : "closed");
+	window = open ? WINDOW_OPEN : WINDOW_CLOSED;
+	if (open) {
+		clock_gettime(CLOCK_MONOTONIC, &window_opened);
+		window_calls = 0;
+	}
+	new_generation();
+	if (task != NULL)
+		control_apply(task);
+}
+
+static void
+window_tick(void *data)
+{
+	if (window != WINDOW_OPEN)
+		return;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	long ms = (now.tv_sec - window_opened.tv_sec) * 1000
+		+ (now.tv_nsec - window_opened.tv_nsec) / 1000000;
+	if (ms >= (long)options.stop_after)
+		set_window(NULL, 0);
+}
+
+int
+control_window_init(void)
+{
+	if (options.start_filter == NULL && options.stop_filter == NULL
+	    && options.stop_after == 0 && options.stop_count == 0)
+		return 0;
+
+	if (options.stop_after != 0
+	    && os_add_timer(WINDOW_TICK, &window_tick, NULL) < 0)
+		return -1;
+
+	/* Without --start-on, the window opens right away.  */
+	set_window(NULL, options.start_filter == NULL);
+	return 0;
+}
+
+int
+control_symbol_within(struct library_symbol *libsym)
+{
+	return options.within_filter != NULL
+		&& filter_matches_symbol(options.within_filter,
+					 libsym->name, libsym->lib);
+}
+
+static int
+task_within(struct process *task)
+{
+	size_t i;
+	for (i = task->callstack_depth; i-- > 0; )
+		if (task->callstack[i].within)
+			return 1;
+	return 0;
+}
+
+int
+control_trace_call(struct process *task, struct breakpoint *bp)
+{
+	if (window == WINDOW_CLOSED && window_trigger(bp->libsym))
+		set_window(task, 1);
+	if (bp->muted != MUTED_NOT)
+		return 0;
+
+	if (options.within_filter != NULL && !task_within(task)
+	    && !control_symbol_within(bp->libsym))
+		return 0;
+
+	/* The call that exhausts the count is still traced.  */
+	if (window == WINDOW_OPEN && options.stop_count > 0
+	    && ++window_calls >= options.stop_count)
+		set_window(task, 0);
+	return 1;
+}
+
+void
+control_trace_return(struct process *task, struct library_symbol *libsym)
+{
+	if (window == WINDOW_OPEN && libsym != NULL
+	    && options.stop_filter != NULL
+	    && filter_matches_symbol(options.stop_filter,
+				     libsym->name, libsym->lib))
+		set_window(task, 0);
+}
+
+static int
+add_rule(const char *expr, int enable)
+{
+	struct control_rule *rule = malloc(sizeof(*rule));
+	if (rule == NULL)
+		return -1;
+	rule->filter = NULL;
+	rule->enable = enable;
+	rule->next = NULL;
+	rule->expr = strdup(expr);
+	if (rule->expr == NULL) {
+		free(rule);
+		return -1;
+	}
+
+	parse_filter_chain(expr, &rule->filter);
+	if (rule->filter == NULL) {
+		free(rule->expr);
+		free(rule);
+		return -1;
+	}
+
+	struct control_rule **it;
+	for (it = &rules; *it != NULL; it = &(*it)->next)
+		;
+	*it = rule;
+	new_generation();
+	return 0;
+}
+
+static void
+free_rule(struct control_rule *rule)
+{
+	while (rule->filter != NULL) {
+		struct filter *filt = rule->filter;
+		rule->filter = filt->next;
+		filter_destroy(filt);
+		free(filt);
+	}
+	free(rule->expr);
+	free(rule);
+}
+
+/* Remove the NUM-th rule, counting from 1.  */
+static int
+remove_rule(unsigned long num)
+{
+	struct control_rule **it;
+	for (it = &rules; *it != NULL && num > 1; it = &(*it)->next)
+		num--;
+	if (*it == NULL || num != 1)
+		return -1;
+
+	struct control_rule *rule = *it;
+	*it = rule->next;
+	free_rule(rule);
+	new_generation();
+	return 0;
+}
+
+static void
+drop_rules(void)
+{
+	while (rules != NULL) {
+		struct control_rule *next = rules->next;
+		free_rule(rules);
+		rules = next;
+	}
+	new_generation();
+}
+
+static void
+reply(int fd, const char *msg)
+{
+	/* The socket is non-blocking, and a client that doesn't read
+	 * its replies doesn't get them.  */
+	size_t len = strlen(msg);
+	if (write(fd, msg, len) != (ssize_t)len)
+		debug(DEBUG_PROCESS, "control: reply to %d lost", fd);
+}
+
+static void
+list_rules(int fd)
+{
+	unsigned num = 0;
+	struct control_rule *it;
+	for (it = rules; it != NULL; it = it->next) {
+		/* Rules come from command lines, which are shorter
+		 * than the buffer of a client.  */
+		char line[2 * sizeof(((struct control_client *)0)->buf)];
+		snprintf(line, sizeof(line), "%u %s %s\n", ++num,
+			 it->enable ? "enable" : "disable", it->expr);
+		reply(fd, line);
+	}
+}
+
+static const char *
+run_command(int fd, char *cmd, char *arg)
+{
+	if (strcmp(cmd, "disable") == 0 || strcmp(cmd, "enable") == 0) {
+		if (*arg == 0)
+			return "error: filter expected\n";
+		if (add_rule(arg, cmd[0] == 'e') < 0)
+			return "error: invalid filter\n";
+
+	} else if (strcmp(cmd, "rules") == 0) {
+		list_rules(fd);
+
+	} else if (strcmp(cmd, "remove") == 0) {
+		char *end;
+		unsigned long num = strtoul(arg, &end, 10);
+		if (*arg == 0 || *end != 0)
+			return "error: rule number expected\n";
+		if (remove_rule(num) < 0)
+			return "error: no such rule\n";
+
+	} else if (strcmp(cmd, "reset") == 0) {
+		drop_rules();
+
+	} else if (strcmp(cmd, "summary") == 0) {
+		if (strcmp(arg, "on") == 0) {
+			options.summary = 1;
+		} else if (strcmp(arg, "off") == 0) {
+			if (options.summary)
+				show_summary();
+			drop_summary();
+			options.summary = 0;
+		} else {
+			return "error: expected on or off\n";
+		}
+
+	} else if (strcmp(cmd, "stats") == 0) {
+		show_summary();
+
+	} else if (strcmp(cmd, "rotate") == 0) {
+		if (options.output_name == NULL)
+			return "error: no output file\n";
+		if (output_reopen(options.output_name) < 0)
+			return "error: couldn't open output file\n";
+
+	} else {
+		return "error: unknown command\n";
+	}
+
+	return "ok\n";
+}
+
+static void
+parse_command(int fd, char *line)
+{
+	char *cmd = line + strspn(line, " \t\r");
+	char *end = cmd + strcspn(cmd, " \t\r");
+	char *arg = end + strspn(end, " \t\r");
+	*end = 0;
+	arg[strcspn(arg, " \t\r")] = 0;
+
+	if (*cmd == 0)
+		return;
+
+	debug(DEBUG_PROCESS, "control: '%s' '%s'", cmd, arg);
+	reply(fd, run_command(fd, cmd, arg));
+	fflush(options.output);
+}
+
+static void
+close_client(struct control_client *client)
+{
+	os_unwatch_fd(client->fd);
+	close(client->fd);
+	free(client);
+}
+
+static void
+client_readable(int fd, void *data)
+{
+	struct control_client *client = data;
+	ssize_t rd = read(fd, client->buf + client->len,
+			  sizeof(client->buf) - client->len);
+	if (rd < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+	if (rd <= 0) {
+		close_client(client);
+		return;
+	}
+	client->len += rd;
+
+	char *line = client->buf;
+	char *nl;
+	while ((nl = memchr(line, '\n',
+			    client->buf + client->len - line)) != NULL) {
+		*nl = 0;
+		parse_command(fd, line);
+		line = nl + 1;
+	}
+
+	client->len -= line - client->buf;
+	memmove(client->buf, line, client->len);
+	if (client->len == sizeof(client->buf)) {
+		reply(fd, "error: command too long\n");
+		close_client(client);
+	}
+}
+
+static void
+listener_readable(int fd, void *data)
+{
+	int cfd = accept4(fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+	if (cfd < 0)
+		return;
+
+	struct control_client *client = malloc(sizeof(*client));
+	if (client != NULL) {
+		client->fd = cfd;
+		client->len = 0;
+	}
+	if (client == NULL || os_watch_fd(cfd, &client_readable, client) < 0) {
+		free(client);
+		close(cfd);
+	}
+}
+
+static void
+control_unlink(void)
+{
+	/* Tracers forked by --split-tracers exit through here as
+	 * well.  */
+	if (getpid() == control_pid)
+		unlink(control_path);
+}
+
+int
+control_init(const char *path)
+{
+	struct sockaddr_un addr = {
+		.sun_family = AF_UNIX,
+	};
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd < 0)
+		return -1;
+
+	/* Whoever can connect can change what is traced, and where
+	 * the output goes.  Only let our user do that.  */
+	mode_t mask = umask(0077);
+	int rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+	umask(mask);
+	if (rc < 0) {
+	fail:
+		close(fd);
+		return -1;
+	}
+
+	control_path = path;
+	control_pid = getpid();
+	atexit(control_unlink);
+
+	if (listen(fd, 4) < 0
+	    || os_watch_fd(fd, &listener_readable, NULL) < 0)
+		goto fail;
+	return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * This file is part of ltrace.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include "forward.h"
+
+/* The control socket lets the user change what is traced while
+ * the tracing runs.  Commands are read a line at a time, see the
+ * description of --control in ltrace(1) for the list.
+ *
+ * Rules given by "enable" and "disable" commands are kept in a list
+ * that is applied to breakpoints of known symbols.  Each change to
+ * the list starts a new generation of rules.  Breakpoints can only
+ * be changed when a task of the process is stopped, so a process
+ * catches up with the current generation the next time that one of
+ * its tasks stops.  */
+
+/* Create the control socket at PATH and start listening for
+ * commands.  Returns 0 on success or a negative value on failure,
+ * with errno set.  */
+int control_init(const char *path);
+
+/* Bring breakpoints of the process of TASK up to date with the
+ * current control rules.  TASK has to be stopped.  */
+void control_apply(struct process *task);
+
+/* Tracing windows are set up by --start-on, --stop-on, --stop-after
+ * and --stop-count.  While the window is closed, only breakpoints
+ * of the symbols matched by --start-on are armed.  When one of them
+ * is called, the window opens and all the other breakpoints are
+ * armed as well.  They are disarmed again when the window closes,
+ * after which it can be opened by --start-on again.  Returns 0 on
+ * success or a negative value on failure.  */
+int control_window_init(void);
+
+/* Answer whether LIBSYM is matched by --within.  Calls made by a
+ * task are only traced while a call of such symbol is on its call
+ * stack.  */
+int control_symbol_within(struct library_symbol *libsym);
+
+/* Called when TASK hits breakpoint BP of a symbol.  Returns non-zero
+ * if the call should be traced.  */
+int control_trace_call(struct process *task, struct breakpoint *bp);
+
+/* Called when a traced call to LIBSYM made by TASK returns.  */
+void control_trace_return(struct process *task,
+			  struct library_symbol *libsym);
+
+#endif /* CONTROL_H */
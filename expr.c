@@ -47,6 +47,7 @@ expr_init_named(struct expr_node *node,
 	expr_init_common(node, EXPR_OP_NAMED);
 	node->u.name.s = name;
 	node->u.name.own = own_name;
+	node->u.name.id = val_dict_intern(name);
 }
 
 void
@@ -192,22 +193,82 @@ eval_up(struct expr_node *node, struct value *context,
 	return 0;
 }
 
+/* Leaf nodes yield a value that already exists somewhere.  If NODE
+ * is a leaf, store a pointer to that value to *RETP and return 1.
+ * Return 0 if NODE is not a leaf, and a negative value on error.  */
+static int
+eval_leaf(struct expr_node *node, struct value *context,
+	  struct value_dict *arguments, struct value **retp)
+{
+	switch (node->kind) {
+	case EXPR_OP_ARGNO:
+		*retp = val_dict_get_num(arguments, node->u.num);
+		break;
+
+	case EXPR_OP_NAMED:
+		if (node->u.name.id >= 0)
+			*retp = val_dict_get_id(arguments, node->u.name.id);
+		else
+			*retp = val_dict_get_name(arguments, node->u.name.s);
+		break;
+
+	case EXPR_OP_SELF:
+		*retp = context;
+		break;
+
+	case EXPR_OP_CONST:
+		*retp = &node->u.value;
+		break;
+
+	default:
+		return 0;
+	}
+
+	return *retp != NULL ? 1 : -1;
+}
+
+/* Evaluate operand NODE of a callback.  Leaf operands are passed to
+ * the callback as they are, other operands are evaluated into TMP.
+ * A pointer to the operand value is stored to *RETP.  */
+static int
+eval_operand(struct expr_node *node, struct value *context,
+	     struct value_dict *arguments, struct value *tmp,
+	     struct value **retp)
+{
+	int st = eval_leaf(node, context, arguments, retp);
+	if (st != 0)
+		return st < 0 ? -1 : 0;
+
+	if (expr_eval(node, context, arguments, tmp) < 0)
+		return -1;
+	*retp = tmp;
+	return 0;
+}
+
+static void
+release_operand(struct value *val, struct value *tmp)
+{
+	if (val == tmp)
+		value_destroy(tmp);
+}
+
 static int
 eval_cb1(struct expr_node *node, struct value *context,
 	 struct value_dict *arguments, struct value *ret_value)
 {
-	struct value val;
-	if (expr_eval(node->lhs, context, arguments, &val) < 0)
+	struct value tmp;
+	struct value *val;
+	if (eval_operand(node->lhs, context, arguments, &tmp, &val) < 0)
 		return -1;
 
 	int ret = 0;
-	if (node->u.call.u.cb1(ret_value, &val, arguments,
+	if (node->u.call.u.cb1(ret_value, val, arguments,
 			       node->u.call.data) < 0)
 		ret = -1;
 
 	/* N.B. the callback must return its own value, or somehow
 	 * clone the incoming argument.  */
-	value_destroy(&val);
+	release_operand(val, &tmp);
 	return ret;
 }
 
@@ -215,25 +276,28 @@ static int
 eval_cb2(struct expr_node *node, struct value *context,
 	 struct value_dict *arguments, struct value *ret_value)
 {
-	struct value lhs;
-	if (expr_eval(node->lhs, context, arguments, &lhs) < 0)
+	struct value lhs_tmp;
+	struct value *lhs;
+	if (eval_operand(node->lhs, context, arguments, &lhs_tmp, &lhs) < 0)
 		return -1;
 
-	struct value rhs;
-	if (expr_eval(node->u.call.rhs, context, arguments, &rhs) < 0) {
-		value_destroy(&lhs);
+	struct value rhs_tmp;
+	struct value *rhs;
+	if (eval_operand(node->u.call.rhs, context, arguments,
+			 &rhs_tmp, &rhs) < 0) {
+		release_operand(lhs, &lhs_tmp);
 		return -1;
 	}
 
 	int ret = 0;
-	if (node->u.call.u.cb2(ret_value, &lhs, &rhs, arguments,
+	if (node->u.call.u.cb2(ret_value, lhs, rhs, arguments,
 			       node->u.call.data) < 0)
 		ret = -1;
 
 	/* N.B. the callback must return its own value, or somehow
 	 * clone the incoming argument.  */
-	value_destroy(&lhs);
-	value_destroy(&rhs);
+	release_operand(lhs, &lhs_tmp);
+	release_operand(rhs, &rhs_tmp);
 	return ret;
 }
 
@@ -261,29 +325,21 @@ int
 expr_eval(struct expr_node *node, struct value *context,
 	  struct value_dict *arguments, struct value *ret_value)
 {
-	switch (node->kind) {
-		struct value *valp;
-	case EXPR_OP_ARGNO:
-		valp = val_dict_get_num(arguments, node->u.num);
-		if (valp == NULL)
-			return -1;
+	struct value *valp;
+	int st = eval_leaf(node, context, arguments, &valp);
+	if (st < 0)
+		return -1;
+	if (st > 0) {
 		*ret_value = *valp;
 		return 0;
+	}
 
+	switch (node->kind) {
+	case EXPR_OP_ARGNO:
 	case EXPR_OP_NAMED:
-		valp = val_dict_get_name(arguments, node->u.name.s);
-		if (valp == NULL)
-			return -1;
-		*ret_value = *valp;
-		return 0;
-
 	case EXPR_OP_SELF:
-		*ret_value = *context;
-		return 0;
-
 	case EXPR_OP_CONST:
-		*ret_value = node->u.value;
-		return 0;
+		break;
 
 	case EXPR_OP_INDEX:
 		return eval_index(node, context, arguments, ret_value);
@@ -306,6 +362,16 @@ int
 expr_eval_word(struct expr_node *node, struct value *context,
 	       struct value_dict *arguments, long *ret_value)
 {
+	/* Lengths are most often constants or references to other
+	 * arguments.  Extract the word from the referenced value
+	 * directly instead of going through a temporary copy.  */
+	struct value *valp;
+	int st = eval_leaf(node, context, arguments, &valp);
+	if (st < 0)
+		return -1;
+	if (st > 0)
+		return value_extract_word(valp, ret_value, arguments);
+
 	struct value val;
 	if (expr_eval(node, context, arguments, &val) < 0)
 		return -1;
@@ -47,6 +47,7 @@ struct expr_node {
 		struct {
 			const char *s;
 			int own;
+			int id;	/* See val_dict_intern.  */
 		} name;
 		struct {
 			struct expr_node *n;
@@ -103,7 +104,9 @@ void expr_init_index(struct expr_node *node,
 void expr_init_up(struct expr_node *node, struct expr_node *lhs, int own_lhs);
 
 /* Callback expression calls CB(eval(LHS), DATA).  LHS is owned if
- * OWN_LHS.  DATA is passed to callback verbatim.  */
+ * OWN_LHS.  DATA is passed to callback verbatim.  If LHS refers to
+ * an existing value, such as an argument or the value in question,
+ * CB is passed that value itself and must not modify it.  */
 void expr_init_cb1(struct expr_node *node,
 		   int (*cb)(struct value *ret_value,
 			     struct value *value,
@@ -41,6 +41,7 @@ filter_destroy(struct filter *filt)
 	for (it = filt->rules; it != NULL; ) {
 		struct filter_rule *next = it->next;
 		filter_rule_destroy(it);
+		free(it);
 		it = next;
 	}
 }
@@ -60,6 +61,7 @@ void
 filter_rule_destroy(struct filter_rule *rule)
 {
 	filter_lib_matcher_destroy(rule->lib_matcher);
+	free(rule->lib_matcher);
 	regfree(&rule->symbol_re);
 }
 
@@ -64,14 +64,16 @@ struct filter {
 void filter_init(struct filter *filt);
 void filter_destroy(struct filter *filt);
 
-/* Both SYMBOL_RE and MATCHER are owned and destroyed by RULE.  */
+/* Both SYMBOL_RE and MATCHER are owned and destroyed by RULE.
+ * MATCHER has to be allocated on the heap.  */
 void filter_rule_init(struct filter_rule *rule, enum filter_rule_type type,
 		      struct filter_lib_matcher *matcher,
 		      regex_t symbol_re);
 
 void filter_rule_destroy(struct filter_rule *rule);
 
-/* RULE is added to FILT and owned and destroyed by it.  */
+/* RULE, allocated on the heap, is added to FILT and owned and
+ * destroyed by it.  */
 void filter_add_rule(struct filter *filt, struct filter_rule *rule);
 
 /* Create a matcher that matches library name.  RE is owned and
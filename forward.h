@@ -21,6 +21,7 @@
 /* Important types defined in other header files are declared
    here.  */
 struct Event;
+struct arena;
 struct process;
 struct arg_type_info;
 struct breakpoint;
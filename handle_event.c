@@ -37,6 +37,7 @@
 #include "backend.h"
 #include "breakpoint.h"
 #include "common.h"
+#include "control.h"
 #include "fetch.h"
 #include "library.h"
 #include "proc.h"
@@ -110,6 +111,19 @@ handle_event(Event *event)
 		}
 	}
 
+	/* The task is stopped now, so changes requested over the
+	 * control socket can be applied to its process.  */
+	switch (event->type) {
+	case EVENT_SIGNAL:
+	case EVENT_SYSCALL:
+	case EVENT_SYSRET:
+	case EVENT_BREAKPOINT:
+		control_apply(event->proc);
+		break;
+	default:
+		break;
+	}
+
 	switch (event->type) {
 	case EVENT_NONE:
 		debug(1, "event: none");
@@ -189,66 +203,53 @@ handle_event(Event *event)
 	}
 }
 
-typedef struct Pending_New Pending_New;
-struct Pending_New {
-	pid_t pid;
-	Pending_New * next;
-};
-static Pending_New * pending_news = NULL;
+/* New tasks whose first stop was seen before the clone event of
+ * their parent.  Indexed by PID.  */
+static Dict *pending_news = NULL;
 
 static int
-pending_new(pid_t pid) {
-	Pending_New * p;
-
+pending_new(pid_t pid)
+{
 	debug(DEBUG_FUNCTION, "pending_new(%d)", pid);
-
-	p = pending_news;
-	while (p) {
-		if (p->pid == pid) {
-			return 1;
-		}
-		p = p->next;
-	}
-	return 0;
+	return pending_news != NULL
+		&& dict_find_entry(pending_news, (void *)(uintptr_t)pid) != NULL;
 }
 
 static void
-pending_new_insert(pid_t pid) {
-	Pending_New * p;
-
+pending_new_insert(pid_t pid)
+{
 	debug(DEBUG_FUNCTION, "pending_new_insert(%d)", pid);
-
-	p = malloc(sizeof(Pending_New));
-	if (!p) {
-		perror("malloc()");
-		exit(1);
-	}
-	p->pid = pid;
-	p->next = pending_news;
-	pending_news = p;
+	if (pending_news == NULL)
+		pending_news = dict_init(dict_key2hash_int, dict_key_cmp_int);
+	if (pending_new(pid))
+		return;
+	dict_enter(pending_news, (void *)(uintptr_t)pid,
+		   (void *)(uintptr_t)pid);
 }
 
 static void
-pending_new_remove(pid_t pid) {
-	Pending_New *p, *pred;
-
+pending_new_remove(pid_t pid)
+{
 	debug(DEBUG_FUNCTION, "pending_new_remove(%d)", pid);
+	if (pending_news != NULL)
+		dict_remove(pending_news, (void *)(uintptr_t)pid);
+}
 
-	p = pending_news;
-	pred = NULL;
-	if (p->pid == pid) {
-		pending_news = p->next;
-		free(p);
-	} else {
-		while (p) {
-			if (p->pid == pid) {
-				pred->next = p->next;
-				free(p);
-			}
-			pred = p;
-			p = p->next;
-		}
-	}
+/* Continue the newly created task PROC.  With --split-tracers, new
+ * processes are handed over to a tracer of their own instead.  */
+static void
+continue_new_task(struct process *proc)
+{
+	/* Hardware breakpoints are not inherited.  */
+	if (options.hw_breakpoints)
+		arch_hw_breakpoints_enable(proc);
+
+	if (options.split_tracers
+	    && proc->state == STATE_ATTACHED
+	    && proc->leader == proc
+	    && split_tracer(proc) >= 0)
+		return;
+	continue_process(proc->pid);
 }
 
 static void
@@ -275,7 +276,8 @@ handle_clone(Event *event)
 	   to be per-thread.  */
 	proc->arch_ptr = NULL;
 
-	if (pending_new(proc->pid)) {
+	int start_now = pending_new(proc->pid);
+	if (start_now) {
 		pending_new_remove(proc->pid);
 		/* XXX this used to be destroy_event_handler call, but
 		 * I don't think we want to call that on a shared
@@ -285,7 +287,6 @@ handle_clone(Event *event)
 			proc->state = STATE_ATTACHED;
 		else
 			proc->state = STATE_IGNORED;
-		continue_process(proc->pid);
 	} else {
 		proc->state = STATE_BEING_CREATED;
 	}
@@ -294,6 +295,11 @@ handle_clone(Event *event)
 		continue_after_vfork(proc);
 	else
 		continue_process(event->proc->pid);
+
+	/* This comes last, because the child may be split off to
+	 * another tracer, where the parent is not known.  */
+	if (start_now)
+		continue_new_task(proc);
 }
 
 static void
@@ -311,7 +317,7 @@ handle_new(Event *event)
 		} else {
 			proc->state = STATE_IGNORED;
 		}
-		continue_process(proc->pid);
+		continue_new_task(proc);
 	}
 }
 
@@ -340,33 +346,40 @@ shortsignal(struct process *proc, int signum)
 	}
 }
 
-static char *
-sysname(struct process *proc, int sysnum)
+static const char *
+syscall_name(struct process *proc, int sysnum)
 {
-	static char result[128];
-	static char *syscalent0[] = {
+	static const char *syscalent0[] = {
 #include "syscallent.h"
 	};
-	static char *syscalent1[] = {
+	static const char *syscalent1[] = {
 #include "syscallent1.h"
 	};
-	static char **syscalents[] = { syscalent0, syscalent1 };
+	static const char **syscalents[] = { syscalent0, syscalent1 };
 	int nsyscals[] = { sizeof syscalent0 / sizeof syscalent0[0],
 		sizeof syscalent1 / sizeof syscalent1[0]
 	};
 
-	debug(DEBUG_FUNCTION, "sysname(pid=%d, sysnum=%d)", proc->pid, sysnum);
-
 	if (proc->personality > sizeof syscalents / sizeof syscalents[0])
 		abort();
-	if (sysnum < 0 || sysnum >= nsyscals[proc->personality]) {
+	if (sysnum < 0 || sysnum >= nsyscals[proc->personality])
+		return NULL;
+	return syscalents[proc->personality][sysnum];
+}
+
+static char *
+sysname(struct process *proc, int sysnum)
+{
+	static char result[128];
+
+	debug(DEBUG_FUNCTION, "sysname(pid=%d, sysnum=%d)", proc->pid, sysnum);
+
+	const char *name = syscall_name(proc, sysnum);
+	if (name == NULL)
 		sprintf(result, "SYS_%d", sysnum);
-		return result;
-	} else {
-		sprintf(result, "SYS_%s",
-			syscalents[proc->personality][sysnum]);
-		return result;
-	}
+	else
+		sprintf(result, "SYS_%s", name);
+	return result;
 }
 
 static char *
@@ -531,6 +544,8 @@ calc_time_spent(struct process *proc)
 static void
 handle_sysret(Event *event) {
 	debug(DEBUG_FUNCTION, "handle_sysret(pid=%d, sysnum=%d)", event->proc->pid, event->e_un.sysnum);
+	os_process_sysret(event->proc,
+			  syscall_name(event->proc, event->e_un.sysnum));
 	if (event->proc->state != STATE_IGNORED) {
 		if (opt_T || options.summary) {
 			calc_time_spent(event->proc);
@@ -615,6 +630,7 @@ handle_breakpoint(Event *event)
 			arch_symbol_ret(event->proc, libsym);
 			output_right_tos(event->proc);
 			callstack_pop(event->proc);
+			control_trace_return(event->proc, libsym);
 
 			/* Pop also any other entries that seem like
 			 * they are linked to the current one: they
@@ -661,7 +677,8 @@ handle_breakpoint(Event *event)
 	 * to look it up again.  */
 	if ((sbp = address2bpstruct(leader, brk_addr)) != NULL) {
 		if (event->proc->state != STATE_IGNORED
-		    && sbp->libsym != NULL) {
+		    && sbp->libsym != NULL
+		    && control_trace_call(event->proc, sbp)) {
 			event->proc->stack_pointer = get_stack_pointer(event->proc);
 			event->proc->return_addr =
 				get_return_addr(event->proc, event->proc->stack_pointer);
@@ -692,7 +709,9 @@ callstack_push_syscall(struct process *proc, int sysnum)
 	}
 
 	elem = &proc->callstack[proc->callstack_depth];
+	struct arena arena = elem->arena;
 	*elem = (struct callstack_element){};
+	elem->arena = arena;
 	elem->is_syscall = 1;
 	elem->c_un.syscall = sysnum;
 	elem->return_addr = NULL;
@@ -718,9 +737,12 @@ callstack_push_symfunc(struct process *proc, struct library_symbol *sym)
 	}
 
 	elem = &proc->callstack[proc->callstack_depth++];
+	struct arena arena = elem->arena;
 	*elem = (struct callstack_element){};
+	elem->arena = arena;
 	elem->is_syscall = 0;
 	elem->c_un.libfunc = sym;
+	elem->within = control_symbol_within(sym);
 
 	elem->return_addr = proc->return_addr;
 	if (elem->return_addr)
@@ -751,5 +773,7 @@ callstack_pop(struct process *proc)
 		free(elem->arguments);
 	}
 
+	arena_reset(&elem->arena);
+
 	proc->callstack_depth--;
 }
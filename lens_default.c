@@ -26,10 +26,12 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "proc.h"
+#include "backend.h"
 #include "lens_default.h"
 #include "value.h"
 #include "expr.h"
@@ -230,6 +232,12 @@ format_argument_cb(FILE *stream, void *ptr)
 static int
 format_struct(FILE *stream, struct value *value, struct value_dict *arguments)
 {
+	/* Fetch the whole structure in one go, the elements are then
+	 * initialized as views into the copy.  If that fails, the
+	 * elements are fetched one at a time, and we display as much
+	 * as is readable.  */
+	value_reify(value, arguments);
+
 	int written = 0;
 	if (acc_fprintf(&written, stream, "{ ") < 0)
 		return -1;
@@ -307,6 +315,15 @@ format_pointer(FILE *stream, struct value *value, struct value_dict *arguments)
 		}
 	}
 
+	/* Don't bother reading through pointers that point to
+	 * unmapped memory, the read would just fail.  */
+	long l;
+	if (value->inferior != NULL
+	    && value_extract_word(value, &l, arguments) == 0
+	    && os_address_mapped(value->inferior,
+				 (arch_addr_t)(uintptr_t)l, 1) == 0)
+		return -1;
+
 	/* OK, not a recursion.  Remember this value for tracking.  */
 	if (VECT_PUSHBACK(&pointers, &value) < 0)
 		return -1;
@@ -325,6 +342,38 @@ done:
 	return o;
 }
 
+/* If the array VALUE is still in the inferior, copy its first COUNT
+ * elements out in one read, and initialize *VIEW to refer to the
+ * copy.  Returns the buffer, which the caller frees when it's done
+ * with *VIEW, or NULL if VALUE should be used as it is.  */
+static void *
+array_view(struct value *view, struct value *value, size_t count)
+{
+	if (value->where != VAL_LOC_INFERIOR || count == 0)
+		return NULL;
+
+	size_t stride = type_offsetof(value->inferior, value->type, 1);
+	if (stride == (size_t)-1 || stride == 0 || count > SIZE_MAX / stride)
+		return NULL;
+	size_t size = count * stride;
+
+	void *buf = malloc(size);
+	if (buf == NULL)
+		return NULL;
+
+	if (umovebytes(value->inferior, value->u.inf_address,
+		       buf, size) != size) {
+		free(buf);
+		return NULL;
+	}
+
+	*view = *value;
+	view->own_type = 0;
+	view->where = VAL_LOC_SHARED;
+	view->u.address = buf;
+	return buf;
+}
+
 /*
  * LENGTH is an expression whose evaluation will yield the actual
  *    length of the array.
@@ -350,36 +399,46 @@ format_array(FILE *stream, struct value *value, struct value_dict *arguments,
 		return -1;
 	size_t len = (size_t)l;
 
+	/* Fetch the elements that will be displayed in one read.  */
+	struct value view;
+	void *buf = array_view(&view, value, len < maxlen ? len : maxlen);
+	if (buf != NULL)
+		value = &view;
+
 	int written = 0;
+	int ret = -1;
 	if (acc_fprintf(&written, stream, "%s", open) < 0)
-		return -1;
+		goto done;
 
 	size_t i;
 	for (i = 0; i < len && i <= maxlen; ++i) {
 		if (i == maxlen) {
 			if (before && acc_fprintf(&written, stream, "...") < 0)
-				return -1;
+				goto done;
 			break;
 		}
 
 		if (i > 0 && acc_fprintf(&written, stream, "%s", delim) < 0)
-			return -1;
+			goto done;
 
 		struct value element;
 		if (value_init_element(&element, value, i) < 0)
-			return -1;
+			goto done;
 		int o = format_argument(stream, &element, arguments);
 		value_destroy(&element);
 		if (o < 0)
-			return -1;
+			goto done;
 		written += o;
 	}
 	if (acc_fprintf(&written, stream, "%s", close) < 0)
-		return -1;
+		goto done;
 	if (i == maxlen && !before && acc_fprintf(&written, stream, "...") < 0)
-		return -1;
+		goto done;
 
-	return written;
+	ret = written;
+done:
+	free(buf);
+	return ret;
 }
 
 static int
@@ -681,6 +740,14 @@ bitvect_lens_format_cb(struct lens *lens, FILE *stream,
 	for (i = 0; i < sz; ++i) {
 		unsigned char m;
 		unsigned char d = data[i] ^ neg;
+
+		/* Bytes that don't end or start a run of bits can be
+		 * skipped as a whole.  */
+		if ((low < 0 && d == 0x00) || (low >= 0 && d == 0xff)) {
+			bitno += 8;
+			continue;
+		}
+
 		for (m = 0x01; m != 0; m <<= 1) {
 			int bit = !!(m & d);
 			if (low < 0) {
@@ -19,6 +19,7 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 #include <string.h>
 
@@ -46,6 +47,20 @@ enum_entry_dtor(struct enum_entry *entry, void *data)
 	}
 }
 
+struct enum_index_entry {
+	uint64_t value;
+	const char *key;
+	size_t i;
+};
+
+struct enum_index {
+	/* Type and width of the entry values.  */
+	enum arg_type type;
+	size_t width;
+	size_t size;
+	struct enum_index_entry entries[];
+};
+
 static void
 enum_lens_destroy_cb(struct lens *lens)
 {
@@ -53,6 +68,7 @@ enum_lens_destroy_cb(struct lens *lens)
 
 	VECT_DESTROY(&self->entries, struct enum_entry,
 		     enum_entry_dtor, NULL);
+	free(self->index);
 }
 
 enum {
@@ -100,10 +116,142 @@ enum_values_equal(struct value *inf_value, struct value *enum_value,
 		return memcmp(enum_data, inf_data, sz) == 0;
 }
 
+/* Read low WIDTH bytes of DATA, which is SZ bytes wide, into a
+ * number.  */
+static uint64_t
+enum_low_bytes(unsigned char *data, size_t sz, size_t width)
+{
+	assert(width <= sz && width <= sizeof(uint64_t));
+	uint64_t ret = 0;
+	size_t i;
+	for (i = 0; i < width; ++i) {
+		unsigned char c = big_endian ? data[sz - 1 - i] : data[i];
+		ret |= (uint64_t)c << (8 * i);
+	}
+	return ret;
+}
+
+static int
+enum_index_entry_cmp(const void *a, const void *b)
+{
+	const struct enum_index_entry *ea = a;
+	const struct enum_index_entry *eb = b;
+	if (ea->value != eb->value)
+		return ea->value < eb->value ? -1 : 1;
+	return ea->i < eb->i ? -1 : ea->i > eb->i;
+}
+
+/* Sort the entries of LENS by value, so that they can be bisected.
+ * That's only possible if all values are of the same type and fit
+ * in 64 bits.  Returns NULL if they don't, or on failure.  */
+static struct enum_index *
+enum_build_index(struct enum_lens *lens, struct value_dict *arguments)
+{
+	size_t n = vect_size(&lens->entries);
+	if (n == 0)
+		return NULL;
+
+	struct enum_index *index
+		= malloc(sizeof(*index) + n * sizeof(*index->entries));
+	if (index == NULL)
+		return NULL;
+
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		struct enum_entry *entry = VECT_ELEMENT(&lens->entries,
+							struct enum_entry, i);
+		unsigned char *data = value_get_data(entry->value, arguments);
+		size_t sz = value_size(entry->value, arguments);
+		if (data == NULL || sz == (size_t)-1
+		    || sz > sizeof(uint64_t)) {
+		fail:
+			free(index);
+			return NULL;
+		}
+
+		if (i == 0) {
+			index->type = entry->value->type->type;
+			index->width = sz;
+		} else if (index->type != entry->value->type->type
+			   || index->width != sz) {
+			goto fail;
+		}
+
+		index->entries[i].value = enum_low_bytes(data, sz, sz);
+		index->entries[i].key = entry->key;
+		index->entries[i].i = i;
+	}
+
+	/* Sort by value and drop duplicates.  Ties are broken by
+	 * the order of entries, so that the first one of the same
+	 * value wins, like in the linear search.  */
+	qsort(index->entries, n, sizeof(*index->entries),
+	      enum_index_entry_cmp);
+	size_t j = 0;
+	for (i = 0; i < n; ++i)
+		if (j == 0 || index->entries[j - 1].value
+		    != index->entries[i].value)
+			index->entries[j++] = index->entries[i];
+	index->size = j;
+
+	return index;
+}
+
+/* Returns 0 if VALUE can't be looked up in the index, 1 if it was
+ * looked up, in which case *RETP is set to the name found, or NULL
+ * if there's none, and a negative value on error.  */
+static int
+enum_index_get(struct enum_lens *lens, struct value *value,
+	       struct value_dict *arguments, const char **retp)
+{
+	if (lens->index == NULL && !lens->no_index) {
+		lens->index = enum_build_index(lens, arguments);
+		lens->no_index = lens->index == NULL;
+	}
+
+	struct enum_index *index = lens->index;
+	if (index == NULL || index->type != value->type->type)
+		return 0;
+
+	/* If the value is narrower than the entries, several of them
+	 * might match it.  Leave that to the linear search.  */
+	size_t sz = value_size(value, arguments);
+	if (sz == (size_t)-1)
+		return -1;
+	if (sz < index->width)
+		return 0;
+
+	unsigned char *data = value_get_data(value, arguments);
+	if (data == NULL)
+		return -1;
+	uint64_t v = enum_low_bytes(data, sz, index->width);
+
+	size_t lo = 0;
+	size_t hi = index->size;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (index->entries[mid].value < v)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	*retp = lo < index->size && index->entries[lo].value == v
+		? index->entries[lo].key : NULL;
+	return 1;
+}
+
 static const char *
 enum_get(struct enum_lens *lens, struct value *value,
 	 struct value_dict *arguments)
 {
+	const char *ret;
+	int st = enum_index_get(lens, value, arguments, &ret);
+	if (st < 0)
+		return NULL;
+	else if (st > 0)
+		return ret;
+
 	size_t i;
 	for (i = 0; i < vect_size(&lens->entries); ++i) {
 		struct enum_entry *entry = VECT_ELEMENT(&lens->entries,
@@ -149,6 +297,9 @@ lens_enum_add(struct enum_lens *lens,
 	      struct value *value, int own_value)
 {
 	struct enum_entry entry = { (char *)key, own_key, value, own_value };
+	free(lens->index);
+	lens->index = NULL;
+	lens->no_index = 0;
 	return VECT_PUSHBACK(&lens->entries, &entry);
 }
 
@@ -24,9 +24,17 @@
 #include "lens.h"
 #include "vect.h"
 
+struct enum_index;
+
 struct enum_lens {
 	struct lens super;
 	struct vect entries;
+
+	/* Entries sorted by value, built on first use.  NULL if it
+	 * wasn't built yet, or if the entries can't be indexed, in
+	 * which case NO_INDEX is set.  */
+	struct enum_index *index;
+	int no_index;
 };
 
 /* Init enumeration LENS.  */
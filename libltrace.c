@@ -32,6 +32,7 @@
 #include <unistd.h>
 
 #include "common.h"
+#include "control.h"
 #include "proc.h"
 #include "read_config_file.h"
 #include "backend.h"
@@ -98,6 +99,15 @@ normal_exit(void)
 	}
 }
 
+/* How often, in milliseconds, is output to a file flushed.  */
+#define OUTPUT_FLUSH_INTERVAL 200
+
+static void
+flush_output(void *data)
+{
+	fflush(options.output);
+}
+
 void
 ltrace_init(int argc, char **argv) {
 	struct opt_p_t *opt_p_tmp;
@@ -107,6 +117,28 @@ ltrace_init(int argc, char **argv) {
 	signal(SIGTERM, signal_exit);	/*  ... or killed */
 
 	argv = process_options(argc, argv);
+
+	if (options.split_tracers && os_check_split_tracers() < 0)
+		exit(EXIT_FAILURE);
+
+	/* Writing output to a file one line at a time is costly.
+	 * Buffer it fully, but still flush it periodically, so that
+	 * the file can be followed while the tracing runs.  */
+	if (options.output != stderr
+	    && os_add_timer(OUTPUT_FLUSH_INTERVAL, &flush_output, NULL) == 0)
+		setvbuf(options.output, (char *)NULL, _IOFBF, BUFSIZ);
+
+	if (control_window_init() < 0) {
+		fprintf(stderr, "couldn't set up tracing window: %s\n",
+			strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (options.control != NULL && control_init(options.control) < 0) {
+		fprintf(stderr, "couldn't create control socket %s: %s\n",
+			options.control, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
 	init_global_config();
 	while (opt_F) {
 		/* If filename begins with ~, expand it to the user's home */
@@ -69,6 +69,18 @@ int opt_r = 0;			/* print relative timestamp */
 int opt_t = 0;			/* print absolute timestamp */
 int opt_T = 0;			/* show the time spent inside each call */
 
+/* Options that only have a long form.  */
+enum {
+	OPT_SPLIT_TRACERS = 256,
+	OPT_HW_BREAKPOINTS,
+	OPT_CONTROL,
+	OPT_START_ON,
+	OPT_STOP_ON,
+	OPT_STOP_AFTER,
+	OPT_STOP_COUNT,
+	OPT_WITHIN,
+};
+
 /* List of pids given to option -p: */
 struct opt_p_t *opt_p = NULL;	/* attach to process with a given pid */
 
@@ -92,12 +104,14 @@ usage(void) {
 # ifdef USE_DEMANGLE
 		"  -C, --demangle      decode low-level symbol names into user-level names.\n"
 # endif
+		"      --control=SOCKET accept commands on a UNIX socket at path SOCKET.\n"
 		"  -D, --debug=MASK    enable debugging (see -Dh or --debug=help).\n"
 		"  -Dh, --debug=help   show help on debugging.\n"
 		"  -e FILTER           modify which library calls to trace.\n"
 		"  -f                  trace children (fork() and clone()).\n"
 		"  -F, --config=FILE   load alternate configuration file (may be repeated).\n"
 		"  -h, --help          display this help and exit.\n"
+		"      --hw-breakpoints use debug registers for frequently hit breakpoints.\n"
 		"  -i                  print instruction pointer at time of library call.\n"
 		"  -l, --library=LIBRARY_PATTERN only trace symbols implemented by this library.\n"
 		"  -L                  do NOT display library calls.\n"
@@ -105,12 +119,18 @@ usage(void) {
 		"  -o, --output=FILENAME write the trace output to file with given name.\n"
 		"  -p PID              attach to the process with the process ID pid.\n"
 		"  -r                  print relative timestamps.\n"
+		"      --split-tracers with -f and -o, trace each forked child in its own ltrace.\n"
+		"      --start-on=FILTER only start tracing when a matching symbol is called.\n"
+		"      --stop-on=FILTER stop tracing when a matching symbol returns.\n"
+		"      --stop-after=SECONDS stop tracing SECONDS after it started.\n"
+		"      --stop-count=NR  stop tracing after NR calls.\n"
 		"  -s STRSIZE          specify the maximum string size to print.\n"
 		"  -S                  trace system calls as well as library calls.\n"
 		"  -t, -tt, -ttt       print absolute timestamps.\n"
 		"  -T                  show the time spent inside each call.\n"
 		"  -u USERNAME         run command with the userid, groupid of username.\n"
 		"  -V, --version       output version information and exit.\n"
+		"      --within=FILTER only trace calls made while inside a matching symbol.\n"
 #if defined(HAVE_LIBUNWIND)
 		"  -w, --where=NR      print backtrace showing NR stack frames at most.\n"
 #endif /* defined(HAVE_LIBUNWIND) */
@@ -409,7 +429,7 @@ slist_chase_end(struct filter **begin)
 	return begin;
 }
 
-static void
+void
 parse_filter_chain(const char *expr, struct filter **retp)
 {
 	char *str = strdup(expr);
@@ -464,15 +484,23 @@ process_options(int argc, char **argv)
 		static struct option long_options[] = {
 			{"align", 1, 0, 'a'},
 			{"config", 1, 0, 'F'},
+			{"control", 1, 0, OPT_CONTROL},
 			{"debug", 1, 0, 'D'},
 # ifdef USE_DEMANGLE
 			{"demangle", 0, 0, 'C'},
 # endif
 			{"indent", 1, 0, 'n'},
 			{"help", 0, 0, 'h'},
+			{"hw-breakpoints", 0, 0, OPT_HW_BREAKPOINTS},
 			{"library", 1, 0, 'l'},
 			{"output", 1, 0, 'o'},
+			{"split-tracers", 0, 0, OPT_SPLIT_TRACERS},
+			{"start-on", 1, 0, OPT_START_ON},
+			{"stop-after", 1, 0, OPT_STOP_AFTER},
+			{"stop-count", 1, 0, OPT_STOP_COUNT},
+			{"stop-on", 1, 0, OPT_STOP_ON},
 			{"version", 0, 0, 'V'},
+			{"within", 1, 0, OPT_WITHIN},
 			{"no-signals", 0, 0, 'b'},
 # if defined(HAVE_LIBUNWIND)
 			{"where", 1, 0, 'w'},
@@ -585,6 +613,7 @@ process_options(int argc, char **argv)
 			}
 			setvbuf(options.output, (char *)NULL, _IOLBF, 0);
 			fcntl(fileno(options.output), F_SETFD, FD_CLOEXEC);
+			options.output_name = optarg;
 			break;
 		case 'p':
 			{
@@ -635,6 +664,58 @@ process_options(int argc, char **argv)
 			parse_filter_chain(optarg, &options.static_filter);
 			break;
 
+		case OPT_SPLIT_TRACERS:
+			options.split_tracers = 1;
+			break;
+
+		case OPT_HW_BREAKPOINTS:
+			options.hw_breakpoints = 1;
+			break;
+
+		case OPT_CONTROL:
+			options.control = optarg;
+			break;
+
+		case OPT_WITHIN:
+			parse_filter_chain(optarg, &options.within_filter);
+			break;
+
+		case OPT_START_ON:
+			parse_filter_chain(optarg, &options.start_filter);
+			break;
+
+		case OPT_STOP_ON:
+			parse_filter_chain(optarg, &options.stop_filter);
+			break;
+
+		case OPT_STOP_AFTER: {
+			char *endptr;
+			double secs = strtod(optarg, &endptr);
+			if (*optarg == 0 || *endptr != 0 || !(secs > 0)
+			    || secs > UINT_MAX / 1000) {
+				fprintf(stderr, "Invalid argument to "
+					"--stop-after: '%s'.\n", optarg);
+				exit(1);
+			}
+			options.stop_after = secs * 1000 + 0.5;
+			if (options.stop_after == 0)
+				options.stop_after = 1;
+			break;
+		}
+
+		case OPT_STOP_COUNT: {
+			char *endptr;
+			long l = strtol(optarg, &endptr, 0);
+			if (*optarg == 0 || *endptr != 0
+			    || l < 1 || l > INT_MAX) {
+				fprintf(stderr, "Invalid argument to "
+					"--stop-count: '%s'.\n", optarg);
+				exit(1);
+			}
+			options.stop_count = l;
+			break;
+		}
+
 		default:
 			err_usage();
 		}
@@ -687,6 +768,18 @@ process_options(int argc, char **argv)
 		fprintf(stderr, "%s: too few arguments\n", progname);
 		err_usage();
 	}
+	if (options.split_tracers && !options.follow) {
+		fprintf(stderr,
+			"%s: Option --split-tracers requires -f\n",
+			progname);
+		err_usage();
+	}
+	if (options.split_tracers && options.output_name == NULL) {
+		fprintf(stderr,
+			"%s: Option --split-tracers requires -o\n",
+			progname);
+		err_usage();
+	}
 	if (opt_r && opt_t) {
 		fprintf(stderr,
 			"%s: Options -r and -t can't be used together\n",
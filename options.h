@@ -33,11 +33,20 @@ struct options_t {
 	int demangle;   /* -C: demangle low-level names into user-level names */
 	int indent;     /* -n: indent trace output according to program flow */
 	FILE *output;   /* output to a specific file */
+	char *output_name; /* -o: name of that file, or NULL */
 	int summary;    /* count time, calls, and report a summary on program exit */
 	int debug;      /* debug */
 	size_t arraylen;   /* default maximum # of array elements printed */
 	size_t strlen;     /* default maximum # of bytes printed in strings */
 	int follow;     /* trace child processes */
+	int split_tracers; /* hand each forked child to its own tracer */
+	int hw_breakpoints; /* move hot breakpoints to debug registers */
+	char *control;  /* --control: path of the control socket, or NULL */
+	struct filter *start_filter; /* --start-on */
+	struct filter *stop_filter;  /* --stop-on */
+	unsigned stop_after; /* --stop-after, in milliseconds, or 0 */
+	int stop_count;      /* --stop-count, or 0 */
+	struct filter *within_filter; /* --within */
 	int no_signals; /* don't print signals */
 #if defined(HAVE_LIBUNWIND)
 	int bt_depth;	 /* how may levels of stack frames to show */
@@ -75,3 +84,8 @@ extern struct opt_p_t *opt_p;	/* attach to process with a given pid */
 extern struct opt_F_t *opt_F;	/* alternate configuration file(s) */
 
 extern char **process_options(int argc, char **argv);
+
+/* Parse filter expression EXPR, in the syntax of -e, and append
+ * the resulting filters to the list at *RETP.  Problems are
+ * reported to stderr, and the offending parts are left out.  */
+void parse_filter_chain(const char *expr, struct filter **retp);
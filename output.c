@@ -33,6 +33,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <assert.h>
+#include <fcntl.h>
 
 #include "common.h"
 #include "proc.h"
@@ -206,6 +207,22 @@ name2func(char const *name) {
 	return def;
 }
 
+int
+output_reopen(const char *name)
+{
+	fflush(options.output);
+	int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		return -1;
+
+	int ret = dup2(fd, fileno(options.output));
+	close(fd);
+	if (ret < 0)
+		return -1;
+	fcntl(fileno(options.output), F_SETFD, FD_CLOEXEC);
+	return 0;
+}
+
 void
 output_line(struct process *proc, const char *fmt, ...)
 {
@@ -483,24 +500,43 @@ output_left(enum tof type, struct process *proc,
 		return;
 	val_dict_init(arguments);
 
+	/* Data of the values fetched for this call are allocated from
+	 * the arena of its stack frame, and released all at once
+	 * when the frame is popped.  */
+	struct callstack_element *stel
+		= &proc->callstack[proc->callstack_depth - 1];
+	struct arena *old_arena = value_set_arena(&stel->arena);
+
 	ssize_t params_left = -1;
 	int need_delim = 0;
 	if (fetch_params(type, proc, context, arguments, func, &params_left) < 0
 	    || output_params(arguments, 0, params_left, &need_delim) < 0) {
 		val_dict_destroy(arguments);
+		free(arguments);
 		fetch_arg_done(context);
 		arguments = NULL;
 		context = NULL;
 	}
 
-	struct callstack_element *stel
-		= &proc->callstack[proc->callstack_depth - 1];
+	value_set_arena(old_arena);
+
 	stel->fetch_context = context;
 	stel->arguments = arguments;
 	stel->out.params_left = params_left;
 	stel->out.need_delim = need_delim;
 }
 
+/* Identifier of the name under which the return value is entered
+ * into the argument dictionary, see val_dict_intern.  */
+static int
+retval_id(void)
+{
+	static int id = -1;
+	if (id < 0)
+		id = val_dict_intern("retval");
+	return id;
+}
+
 void
 output_right(enum tof type, struct process *proc, struct library_symbol *libsym)
 {
@@ -563,6 +599,7 @@ output_right(enum tof type, struct process *proc, struct library_symbol *libsym)
 		= &proc->callstack[proc->callstack_depth - 1];
 
 	struct fetch_context *context = stel->fetch_context;
+	struct arena *old_arena = value_set_arena(&stel->arena);
 
 	/* Fetch & enter into dictionary the retval first, so that
 	 * other values can use it in expressions.  */
@@ -575,8 +612,8 @@ output_right(enum tof type, struct process *proc, struct library_symbol *libsym)
 				 &retval) < 0)
 			value_set_type(&retval, NULL, 0);
 		else if (stel->arguments != NULL
-			   && val_dict_push_named(stel->arguments, &retval,
-						  "retval", 0) == 0)
+			   && val_dict_push_id(stel->arguments, &retval,
+					       retval_id()) == 0)
 			own_retval = 0;
 	}
 
@@ -597,6 +634,8 @@ output_right(enum tof type, struct process *proc, struct library_symbol *libsym)
 	if (own_retval)
 		value_destroy(&retval);
 
+	value_set_arena(old_arena);
+
 	if (opt_T) {
 		fprintf(options.output, " <%lu.%06d>",
 			(unsigned long)current_time_spent.tv_sec,
@@ -25,6 +25,12 @@
 #include "forward.h"
 
 void output_line(struct process *proc, const char *fmt, ...);
+
+/* Flush options.output and point it to a newly created file NAME.
+ * The stream itself, and therefore its buffering, is kept.  Returns
+ * 0 on success or a negative value on failure, in which case the
+ * output is left alone.  */
+int output_reopen(const char *name);
 void output_left(enum tof type, struct process *proc,
 		 struct library_symbol *libsym);
 void output_right(enum tof type, struct process *proc,
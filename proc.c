@@ -232,6 +232,10 @@ private_process_destroy(struct process *proc, int was_exec)
 		callstack_pop(proc);
 	}
 
+	size_t i;
+	for (i = 0; i < MAX_CALLDEPTH; ++i)
+		arena_destroy(&proc->callstack[i].arena);
+
 	if (!was_exec)
 		free(proc->filename);
 
@@ -386,7 +390,12 @@ process_clone(struct process *retp, struct process *proc, pid_t pid)
 	memcpy(retp->callstack, proc->callstack, sizeof(retp->callstack));
 	retp->callstack_depth = proc->callstack_depth;
 
+	/* The arenas are not shared, values in ARGUMENTS are copied
+	 * out of them by val_dict_clone below.  */
 	size_t i;
+	for (i = 0; i < MAX_CALLDEPTH; ++i)
+		arena_init(&retp->callstack[i].arena);
+
 	for (i = 0; i < retp->callstack_depth; ++i) {
 		struct callstack_element *elem = &retp->callstack[i];
 		struct fetch_context *ctx = elem->fetch_context;
@@ -545,24 +554,46 @@ open_pid(pid_t pid)
 	each_task(leader, NULL, start_one_pid, NULL);
 }
 
-static enum callback_status
-find_proc(struct process *proc, void *data)
+static struct process *list_of_processes = NULL;
+
+/* Index of processes in LIST_OF_PROCESSES by PID.  pid2proc is called
+ * for every event that we see, so with many traced tasks, it
+ * shouldn't need to walk the whole list.  */
+static Dict *pid_index = NULL;
+
+static void
+index_process(struct process *proc)
 {
-	pid_t pid = (pid_t)(uintptr_t)data;
-	return proc->pid == pid ? CBS_STOP : CBS_CONT;
+	if (pid_index == NULL)
+		pid_index = dict_init(dict_key2hash_int, dict_key_cmp_int);
+
+	/* If there's a stale record for this PID, the newer process
+	 * takes precedence.  */
+	void *key = (void *)(uintptr_t)proc->pid;
+	dict_remove(pid_index, key);
+	dict_enter(pid_index, key, proc);
+}
+
+static void
+unindex_process(struct process *proc)
+{
+	void *key = (void *)(uintptr_t)proc->pid;
+	if (pid_index != NULL && dict_find_entry(pid_index, key) == proc)
+		dict_remove(pid_index, key);
 }
 
 struct process *
 pid2proc(pid_t pid)
 {
-	return each_process(NULL, &find_proc, (void *)(uintptr_t)pid);
+	if (pid_index == NULL)
+		return NULL;
+	return dict_find_entry(pid_index, (void *)(uintptr_t)pid);
 }
 
-static struct process *list_of_processes = NULL;
-
 static void
 unlist_process(struct process *proc)
 {
+	unindex_process(proc);
 	if (list_of_processes == proc) {
 		list_of_processes = list_of_processes->next;
 		return;
@@ -656,6 +687,7 @@ add_process(struct process *proc, int was_exec)
 	if (!was_exec) {
 		proc->next = *leaderp;
 		*leaderp = proc;
+		index_process(proc);
 	}
 }
 
@@ -674,6 +706,7 @@ change_process_leader(struct process *proc, struct process *leader)
 	proc->leader = leader;
 	proc->next = *leaderp;
 	*leaderp = proc;
+	index_process(proc);
 }
 
 static enum callback_status
@@ -842,6 +875,10 @@ proc_add_library(struct process *proc, struct library *lib)
 	debug(DEBUG_PROCESS, "added library %s@%p (%s) to %d",
 	      lib->soname, lib->base, lib->pathname, proc->pid);
 
+	/* The control socket rules need to be applied to the new
+	 * breakpoints as well.  */
+	proc->control_applied = 0;
+
 	/* Insert breakpoints for all active (non-latent) symbols.  */
 	struct library_symbol *libsym = NULL;
 	while ((libsym = library_each_symbol(lib, libsym,
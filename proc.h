@@ -33,6 +33,7 @@
 #endif /* defined(HAVE_LIBUNWIND) */
 
 #include "ltrace.h"
+#include "arena.h"
 #include "dict.h"
 #include "sysdep.h"
 #include "callback.h"
@@ -70,6 +71,12 @@ struct callstack_element {
 	struct fetch_context *fetch_context;
 	struct value_dict *arguments;
 	struct output_state out;
+	int within;	/* Whether this is a call of a --within symbol.  */
+
+	/* Memory for data of ARGUMENTS, released when the element is
+	 * popped.  The arena is kept between calls made at this
+	 * depth.  */
+	struct arena arena;
 };
 
 /* XXX We should get rid of this.  */
@@ -130,6 +137,10 @@ struct process {
 	/* Set in leader.  */
 	struct event_handler *event_handler;
 
+	/* Generation of control socket rules that were last applied
+	 * to the breakpoints of this leader.  See control.h.  */
+	unsigned control_applied;
+
 	/**
 	 * Process chaining.
 	 **/
@@ -71,12 +71,33 @@ static int compar(const void *a, const void *b)
 	}
 }
 
+static void
+free_summary_entry(void *key, void *value, void *data)
+{
+	free(key);
+	free(value);
+}
+
+void
+drop_summary(void)
+{
+	if (dict_opt_c == NULL)
+		return;
+	dict_apply_to_all(dict_opt_c, &free_summary_entry, NULL);
+	dict_clear(dict_opt_c);
+	dict_opt_c = NULL;
+}
+
 void show_summary(void)
 {
 	int i;
 
+	/* This may be called several times through the control
+	 * socket.  */
 	num_entries = 0;
 	entries = NULL;
+	tot_count = 0;
+	tot_usecs = 0;
 
 	dict_apply_to_all(dict_opt_c, fill_struct, NULL);
 
@@ -89,7 +110,7 @@ void show_summary(void)
 		unsigned long long int p;
 		c = 1000000 * (int)entries[i].tv.tv_sec +
 		    (int)entries[i].tv.tv_usec;
-		p = 100000 * c / tot_usecs + 5;
+		p = tot_usecs > 0 ? 100000 * c / tot_usecs + 5 : 0;
 		fprintf(options.output, "%3lu.%02lu %4d.%06d %11lu %9d %s\n",
 		       (unsigned long int)(p / 1000),
 		       (unsigned long int)((p / 10) % 100),
@@ -104,4 +125,5 @@ void show_summary(void)
 	fprintf(options.output, "------ ----------- ----------- --------- --------------------\n");
 	fprintf(options.output, "100.00 %4lu.%06lu             %9d total\n", tot_usecs / 1000000,
 	       tot_usecs % 1000000, tot_count);
+	free(entries);
 }
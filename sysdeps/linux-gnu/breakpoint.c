@@ -33,6 +33,7 @@
 #include "breakpoint.h"
 #include "proc.h"
 #include "library.h"
+#include "linux-gnu/trace.h"
 
 #ifdef ARCH_HAVE_ENABLE_BREAKPOINT
 extern void arch_enable_breakpoint(pid_t, struct breakpoint *);
@@ -83,6 +84,11 @@ enable_breakpoint(struct process *proc, struct breakpoint *sbp)
 {
 	debug(DEBUG_PROCESS, "enable_breakpoint: pid=%d, addr=%p, symbol=%s",
 	      proc->pid, sbp->addr, breakpoint_name(sbp));
+
+	/* A breakpoint in a debug register would fire twice.  */
+	if (arch_hw_breakpoint_p(sbp))
+		return;
+	linux_mem_cache_flush();
 	arch_enable_breakpoint(proc->pid, sbp);
 }
 
@@ -131,5 +137,10 @@ disable_breakpoint(struct process *proc, struct breakpoint *sbp)
 {
 	debug(DEBUG_PROCESS, "disable_breakpoint: pid=%d, addr=%p, symbol=%s",
 	      proc->pid, sbp->addr, breakpoint_name(sbp));
+
+	/* Nothing in memory to restore.  */
+	if (arch_hw_breakpoint_p(sbp))
+		return;
+	linux_mem_cache_flush();
 	arch_disable_breakpoint(proc->pid, sbp);
 }
@@ -22,12 +22,16 @@
 #include "config.h"
 
 #define	_GNU_SOURCE	1
+#include <sys/epoll.h>
 #include <sys/ptrace.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <assert.h>
 #include <errno.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,16 +40,143 @@
 #include "backend.h"
 #include "breakpoint.h"
 #include "debug.h"
+#include "dict.h"
 #include "events.h"
+#include "options.h"
 #include "proc.h"
+#include "linux-gnu/trace.h"
 #include "linux-gnu/trace-defs.h"
 
 static Event event;
 
-/* A queue of events that we missed while enabling the
- * breakpoint in one of tasks.  */
-static Event * delayed_events = NULL;
-static Event * end_delayed_events = NULL;
+/* A queue of events that we missed while enabling the breakpoint in
+ * one of tasks.  Events are kept in per-task FIFO queues, which are
+ * indexed by PID, so that we can answer whether there are events for
+ * a given task without scanning everything.  Tasks whose queue is
+ * non-empty are moreover chained in a ready list, in the order in
+ * which their queues became non-empty.  */
+struct qd_task {
+	pid_t pid;
+	Event *head;
+	Event *tail;
+
+	/* Links in the ready list.  */
+	struct qd_task *prev;
+	struct qd_task *next;
+};
+
+static Dict *qd_tasks = NULL;
+static struct qd_task *qd_ready = NULL;
+static struct qd_task *qd_ready_end = NULL;
+
+/* Event nodes are recycled through this free list.  During
+ * stop-the-world cycles, we queue one event per task, and then
+ * dequeue them all shortly afterwards, so there is little point in
+ * going through malloc and free every time.  */
+static Event *free_events = NULL;
+static size_t free_events_count = 0;
+#define MAX_FREE_EVENTS 256
+
+static Event *
+qd_event_alloc(void)
+{
+	Event *ev = free_events;
+	if (ev == NULL)
+		return malloc(sizeof(*ev));
+
+	free_events = ev->next;
+	--free_events_count;
+	return ev;
+}
+
+static void
+qd_event_release(Event *ev)
+{
+	if (free_events_count >= MAX_FREE_EVENTS) {
+		free(ev);
+		return;
+	}
+
+	ev->next = free_events;
+	free_events = ev;
+	++free_events_count;
+}
+
+static struct qd_task *
+qd_task_find(pid_t pid)
+{
+	if (qd_tasks == NULL)
+		return NULL;
+	return dict_find_entry(qd_tasks, (void *)(uintptr_t)pid);
+}
+
+static struct qd_task *
+qd_task_get(pid_t pid)
+{
+	struct qd_task *task = qd_task_find(pid);
+	if (task != NULL)
+		return task;
+
+	if (qd_tasks == NULL) {
+		qd_tasks = dict_init(dict_key2hash_int, dict_key_cmp_int);
+		if (qd_tasks == NULL)
+			return NULL;
+	}
+
+	task = calloc(1, sizeof(*task));
+	if (task == NULL)
+		return NULL;
+	task->pid = pid;
+
+	if (dict_enter(qd_tasks, (void *)(uintptr_t)pid, task) < 0) {
+		free(task);
+		return NULL;
+	}
+	return task;
+}
+
+static void
+qd_ready_link(struct qd_task *task)
+{
+	task->next = NULL;
+	task->prev = qd_ready_end;
+	if (qd_ready_end != NULL)
+		qd_ready_end->next = task;
+	else
+		qd_ready = task;
+	qd_ready_end = task;
+}
+
+static void
+qd_ready_unlink(struct qd_task *task)
+{
+	if (task->prev != NULL)
+		task->prev->next = task->next;
+	else
+		qd_ready = task->next;
+	if (task->next != NULL)
+		task->next->prev = task->prev;
+	else
+		qd_ready_end = task->prev;
+	task->prev = task->next = NULL;
+}
+
+/* Unlink EVENT from the queue of TASK.  PREV is the event preceding
+ * EVENT in that queue, or NULL if EVENT is the queue head.  */
+static void
+qd_task_unlink(struct qd_task *task, Event *prev, Event *event)
+{
+	if (prev == NULL)
+		task->head = event->next;
+	else
+		prev->next = event->next;
+	if (task->tail == event)
+		task->tail = prev;
+	event->next = NULL;
+
+	if (task->head == NULL)
+		qd_ready_unlink(task);
+}
 
 static enum callback_status
 first(struct process *proc, void *data)
@@ -58,7 +189,8 @@ enque_event(Event * event)
 {
 	debug(DEBUG_FUNCTION, "%d: queuing event %d for later",
 	      event->proc->pid, event->type);
-	Event * ne = malloc(sizeof(*ne));
+	struct qd_task *task = qd_task_get(event->proc->pid);
+	Event * ne = task != NULL ? qd_event_alloc() : NULL;
 	if (ne == NULL) {
 		fprintf(stderr, "event will be missed: %s\n", strerror(errno));
 		return;
@@ -66,22 +198,25 @@ enque_event(Event * event)
 
 	*ne = *event;
 	ne->next = NULL;
-	if (end_delayed_events == NULL) {
-		assert(delayed_events == NULL);
-		end_delayed_events = delayed_events = ne;
-	}
-	else {
-		assert(delayed_events != NULL);
-		end_delayed_events = end_delayed_events->next = ne;
+	if (task->tail == NULL) {
+		assert(task->head == NULL);
+		task->head = task->tail = ne;
+		qd_ready_link(task);
+	} else {
+		assert(task->head != NULL);
+		task->tail = task->tail->next = ne;
 	}
 }
 
-Event *
-each_qd_event(enum ecb_status (*pred)(Event *, void *), void * data)
+/* Run PRED on events queued for TASK.  Returns the event for which
+ * PRED answered ECB_YIELD or ECB_DEQUE, or NULL if none did.  */
+static Event *
+each_qd_event_in(struct qd_task *task,
+		 enum ecb_status (*pred)(Event *, void *), void *data)
 {
-	Event * prev = delayed_events;
-	Event * event;
-	for (event = prev; event != NULL; ) {
+	Event *prev = NULL;
+	Event *event;
+	for (event = task->head; event != NULL; ) {
 		switch ((*pred)(event, data)) {
 		case ECB_CONT:
 			prev = event;
@@ -92,18 +227,7 @@ each_qd_event(enum ecb_status (*pred)(Event *, void *), void * data)
 			debug(DEBUG_FUNCTION, "dequeuing event %d for %d",
 			      event->type,
 			      event->proc != NULL ? event->proc->pid : -1);
-			/*
-			printf("dequeuing event %d for %d\n", event->type,
-			       event->proc != NULL ? event->proc->pid : -1) ;
-			*/
-			if (end_delayed_events == event)
-				end_delayed_events = prev;
-			if (delayed_events == event)
-				delayed_events = event->next;
-			else
-				prev->next = event->next;
-			if (delayed_events == NULL)
-				end_delayed_events = NULL;
+			qd_task_unlink(task, prev, event);
 			/* fall-through */
 
 		case ECB_YIELD:
@@ -114,25 +238,372 @@ each_qd_event(enum ecb_status (*pred)(Event *, void *), void * data)
 	return NULL;
 }
 
-static enum ecb_status
-event_process_not_reenabling(Event * event, void * data)
+Event *
+each_qd_event(enum ecb_status (*pred)(Event *, void *), void * data)
 {
-	if (event->proc == NULL
-	    || event->proc->leader == NULL
-	    || event->proc->leader->event_handler == NULL)
-		return ECB_DEQUE;
-	else
-		return ECB_CONT;
+	struct qd_task *task;
+	for (task = qd_ready; task != NULL; task = task->next) {
+		Event *event = each_qd_event_in(task, pred, data);
+		if (event != NULL)
+			return event;
+	}
+
+	return NULL;
+}
+
+Event *
+each_qd_event_for(pid_t pid,
+		  enum ecb_status (*pred)(Event *, void *), void *data)
+{
+	struct qd_task *task = qd_task_find(pid);
+	if (task == NULL)
+		return NULL;
+	return each_qd_event_in(task, pred, data);
+}
+
+int
+have_events_for(pid_t pid)
+{
+	struct qd_task *task = qd_task_find(pid);
+	return task != NULL && task->head != NULL;
 }
 
+/* All events queued for a single task share the same process, so
+ * it's enough to look at the queue heads to find the first event
+ * whose thread group is not mid-reenablement.  */
 static Event *
 next_qd_event(void)
 {
-	return each_qd_event(&event_process_not_reenabling, NULL);
+	struct qd_task *task;
+	for (task = qd_ready; task != NULL; task = task->next) {
+		Event *event = task->head;
+		assert(event != NULL);
+		if (event->proc == NULL
+		    || event->proc->leader == NULL
+		    || event->proc->leader->event_handler == NULL) {
+			debug(DEBUG_FUNCTION, "dequeuing event %d for %d",
+			      event->type,
+			      event->proc != NULL ? event->proc->pid : -1);
+			qd_task_unlink(task, NULL, event);
+			return event;
+		}
+	}
+
+	return NULL;
 }
 
 int linux_in_waitpid = 0;
 
+/* Wait statuses that were collected from the kernel, but not yet
+ * turned into events.  The kernel reports ready tasks in the order
+ * of their PIDs, so if we just waited for one status at a time, a
+ * task that keeps hitting breakpoints could starve tasks that come
+ * after it.  So we take all the statuses that are ready at once, and
+ * only ask for more after all of them were handled.  That way each
+ * task is served once per round.  */
+static struct {
+	pid_t pid;
+	int status;
+} *harvest = NULL;
+static size_t harvest_count = 0;
+static size_t harvest_next = 0;
+static size_t harvest_alloc = 0;
+
+static int
+harvest_reserve(void)
+{
+	if (harvest_count < harvest_alloc)
+		return 0;
+	size_t alloc = harvest_alloc > 0 ? 2 * harvest_alloc : 16;
+	void *ns = realloc(harvest, alloc * sizeof(*harvest));
+	if (ns == NULL)
+		return -1;
+	harvest = ns;
+	harvest_alloc = alloc;
+	return 0;
+}
+
+/* Descriptors and timers that the main loop watches besides the
+ * traced processes.  Timers have TIMER_CB set, other descriptors
+ * have FD_CB set.  */
+struct loop_watch {
+	int fd;
+	void (*fd_cb)(int fd, void *data);
+	void (*timer_cb)(void *data);
+	unsigned interval;
+	void *data;
+};
+
+static struct loop_watch *watches = NULL;
+static size_t watches_count = 0;
+static size_t watches_alloc = 0;
+
+/* Tracing events are noticed through a signalfd for SIGCHLD.  The
+ * epoll set is only created once there is something to watch,
+ * until then (or if it can't be created) we just block in
+ * waitpid.  */
+static int loop_epfd = -1;
+static int loop_sigfd = -1;
+static enum {
+	LOOP_NONE,
+	LOOP_EPOLL,
+	LOOP_FAILED,
+} loop_state = LOOP_NONE;
+
+static struct loop_watch *
+find_watch(int fd)
+{
+	size_t i;
+	for (i = 0; i < watches_count; ++i)
+		if (watches[i].fd == fd)
+			return &watches[i];
+	return NULL;
+}
+
+static int
+loop_add_fd(int fd)
+{
+	struct epoll_event ev = {
+		.events = EPOLLIN,
+		.data.fd = fd,
+	};
+	return epoll_ctl(loop_epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static int
+add_watch(struct loop_watch *watch)
+{
+	if (watches_count >= watches_alloc) {
+		size_t alloc = watches_alloc > 0 ? 2 * watches_alloc : 4;
+		void *nw = realloc(watches, alloc * sizeof(*watches));
+		if (nw == NULL)
+			return -1;
+		watches = nw;
+		watches_alloc = alloc;
+	}
+
+	if (loop_state == LOOP_EPOLL && loop_add_fd(watch->fd) < 0)
+		return -1;
+	watches[watches_count++] = *watch;
+	return 0;
+}
+
+static int
+arm_timer(unsigned interval_ms)
+{
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if (fd < 0)
+		return -1;
+
+	struct itimerspec its;
+	its.it_interval.tv_sec = interval_ms / 1000;
+	its.it_interval.tv_nsec = (interval_ms % 1000) * 1000000;
+	its.it_value = its.it_interval;
+	if (timerfd_settime(fd, 0, &its, NULL) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int
+os_watch_fd(int fd, void (*cb)(int fd, void *data), void *data)
+{
+	struct loop_watch watch = {
+		.fd = fd,
+		.fd_cb = cb,
+		.data = data,
+	};
+	return add_watch(&watch);
+}
+
+void
+os_unwatch_fd(int fd)
+{
+	struct loop_watch *watch = find_watch(fd);
+	if (watch == NULL)
+		return;
+	if (loop_state == LOOP_EPOLL)
+		epoll_ctl(loop_epfd, EPOLL_CTL_DEL, fd, NULL);
+	*watch = watches[--watches_count];
+}
+
+int
+os_add_timer(unsigned interval_ms, void (*cb)(void *data), void *data)
+{
+	if (interval_ms == 0)
+		interval_ms = 1;
+	struct loop_watch watch = {
+		.fd = arm_timer(interval_ms),
+		.timer_cb = cb,
+		.interval = interval_ms,
+		.data = data,
+	};
+	if (watch.fd < 0 || add_watch(&watch) < 0) {
+		if (watch.fd >= 0)
+			close(watch.fd);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+loop_fini(void)
+{
+	if (loop_epfd >= 0)
+		close(loop_epfd);
+	if (loop_sigfd >= 0)
+		close(loop_sigfd);
+	loop_epfd = loop_sigfd = -1;
+}
+
+/* This is only called when we are about to wait for the first
+ * time, so that the tracee that we started doesn't inherit the
+ * blocked SIGCHLD.  */
+static int
+loop_init(void)
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+
+	loop_epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (loop_epfd < 0
+	    || sigprocmask(SIG_BLOCK, &mask, NULL) < 0
+	    || (loop_sigfd = signalfd(-1, &mask,
+				      SFD_CLOEXEC | SFD_NONBLOCK)) < 0
+	    || loop_add_fd(loop_sigfd) < 0)
+		goto fail;
+
+	size_t i;
+	for (i = 0; i < watches_count; ++i)
+		if (loop_add_fd(watches[i].fd) < 0)
+			goto fail;
+
+	return 0;
+
+fail:
+	fprintf(stderr, "couldn't set up event loop: %s\n", strerror(errno));
+	loop_fini();
+	return -1;
+}
+
+void
+linux_event_loop_forked(void)
+{
+	loop_fini();
+	loop_state = LOOP_NONE;
+
+	size_t i = 0;
+	while (i < watches_count) {
+		struct loop_watch *watch = &watches[i];
+		/* The timer itself is shared with the parent.  */
+		close(watch->fd);
+		if (watch->timer_cb != NULL
+		    && (watch->fd = arm_timer(watch->interval)) >= 0)
+			++i;
+		else
+			*watch = watches[--watches_count];
+	}
+}
+
+static void
+loop_dispatch(struct epoll_event *evs, int n)
+{
+	int i;
+	for (i = 0; i < n; ++i) {
+		int fd = evs[i].data.fd;
+		if (fd == loop_sigfd) {
+			struct signalfd_siginfo si;
+			while (read(loop_sigfd, &si, sizeof(si)) > 0)
+				;
+			continue;
+		}
+
+		/* An earlier callback may have removed this watch.  */
+		struct loop_watch *watch = find_watch(fd);
+		if (watch == NULL)
+			continue;
+		if (watch->timer_cb != NULL) {
+			uint64_t expirations;
+			if (read(fd, &expirations, sizeof(expirations)) > 0)
+				watch->timer_cb(watch->data);
+		} else {
+			watch->fd_cb(fd, watch->data);
+		}
+	}
+}
+
+/* Like waitpid(-1, STATUSP, __WALL), but also serve the watched
+ * descriptors and timers.  Those are only looked at once per round
+ * of tracing events, so they add no latency to handling of the
+ * tracee, and are not starved by a busy one either.  */
+static pid_t
+loop_wait(int *statusp)
+{
+	if (loop_state == LOOP_NONE && watches_count > 0)
+		loop_state = loop_init() < 0 ? LOOP_FAILED : LOOP_EPOLL;
+	if (loop_state != LOOP_EPOLL)
+		return waitpid(-1, statusp, __WALL);
+
+	while (1) {
+		/* SIGCHLD is blocked, so any status that appears
+		 * after this call makes the signalfd readable.  */
+		pid_t pid = waitpid(-1, statusp, __WALL | WNOHANG);
+		if (pid < 0)
+			return pid;
+
+		struct epoll_event evs[8];
+		int n = epoll_wait(loop_epfd, evs, sizeof(evs) / sizeof(*evs),
+				   pid > 0 ? 0 : -1);
+		if (n < 0 && pid == 0)
+			return -1;
+		if (n > 0) {
+			/* The callbacks are not a safe place to
+			 * detach from the exit signal handler.  */
+			linux_in_waitpid = 0;
+			loop_dispatch(evs, n);
+			linux_in_waitpid = 1;
+		}
+		if (pid > 0)
+			return pid;
+	}
+}
+
+/* Like waitpid(-1, STATUSP, __WALL), but serve statuses collected
+ * earlier first.  */
+static pid_t
+harvest_wait(int *statusp)
+{
+	while (harvest_next < harvest_count) {
+		/* Statuses of tasks that were removed meanwhile
+		 * have PID of 0.  */
+		pid_t pid = harvest[harvest_next].pid;
+		*statusp = harvest[harvest_next++].status;
+		if (pid != 0)
+			return pid;
+	}
+
+	harvest_next = harvest_count = 0;
+	linux_in_waitpid = 1;
+	pid_t pid = loop_wait(statusp);
+	linux_in_waitpid = 0;
+	if (pid <= 0)
+		return pid;
+
+	/* Make room before reaping, so that no status is lost.  */
+	int status;
+	pid_t other;
+	while (harvest_reserve() == 0
+	       && (other = waitpid(-1, &status, __WALL | WNOHANG)) > 0) {
+		harvest[harvest_count].pid = other;
+		harvest[harvest_count].status = status;
+		harvest_count++;
+	}
+
+	return pid;
+}
+
 Event *
 next_event(void)
 {
@@ -145,18 +616,18 @@ next_event(void)
 	Event * ev;
 	if ((ev = next_qd_event()) != NULL) {
 		event = *ev;
-		free(ev);
+		qd_event_release(ev);
 		return &event;
 	}
 
-	if (!each_process(NULL, &first, NULL)) {
+	/* With --split-tracers, wait for the other tracers to finish
+	 * before exiting.  */
+	if (!each_process(NULL, &first, NULL) && !have_split_tracers()) {
 		debug(DEBUG_EVENT, "event: No more traced programs: exiting");
 		exit(0);
 	}
 
-	linux_in_waitpid = 1;
-	pid = waitpid(-1, &status, __WALL);
-	linux_in_waitpid = 0;
+	pid = harvest_wait(&status);
 
 	if (pid == -1) {
 		if (errno == ECHILD) {
@@ -170,28 +641,19 @@ next_event(void)
 		perror("wait");
 		exit(1);
 	}
+	if (reap_split_tracer(pid)) {
+		debug(DEBUG_EVENT, "event: tracer %d terminated", pid);
+		event.type = EVENT_NONE;
+		event.proc = NULL;
+		return &event;
+	}
 	event.proc = pid2proc(pid);
 	if (!event.proc || event.proc->state == STATE_BEING_CREATED) {
-		/* Work around (presumably) a bug on some kernels,
-		 * where we are seeing a waitpid event even though the
-		 * process is still reported to be running.  Wait for
-		 * the tracing stop to propagate.  But don't get stuck
-		 * here forever.
-		 *
-		 * We need the process in T, because there's a lot of
-		 * ptracing going on all over the place, and these
-		 * calls fail when the process is not in T.
-		 *
-		 * N.B. This was observed on RHEL 5 Itanium, but I'm
-		 * turning this on globally, to save some poor soul
-		 * down the road (which could well be me a year from
-		 * now) the pain of figuring this out all over again.
-		 * Petr Machata 2011-11-22.  */
-		int i = 0;
-		for (; i < 100 && process_status(pid) != PS_TRACING_STOP; ++i) {
-			debug(2, "waiting for %d to stop", pid);
-			usleep(10000);
-		}
+		/* This is the first stop of a newly created task.  It
+		 * may come before or after the clone event of its
+		 * parent, handle_new and handle_clone pair the two up.
+		 * As far as waitpid is concerned, the task is in
+		 * tracing stop, so don't poll /proc to confirm it.  */
 		event.type = EVENT_NEW;
 		event.e_un.newpid = pid;
 		debug(DEBUG_EVENT, "event: NEW: pid=%d", pid);
@@ -207,22 +669,19 @@ next_event(void)
 	 * 'R' and 'Z'.  Calls to ptrace fail and /proc/pid/status may
 	 * not even be available anymore, so we can't check in
 	 * advance.  So we just drop the error checking around ptrace
-	 * calls.  We check for termination ex post when it fails,
-	 * suppress the event, and let the event loop collect the
-	 * termination in the next iteration.  */
+	 * calls.  We check for termination ex post when it fails:
+	 * ptrace answers ESRCH for tasks that are gone or not
+	 * stopped.  We suppress the event, and let the event loop
+	 * collect the termination in the next iteration.  */
 #define CHECK_PROCESS_TERMINATED					\
 	do {								\
-		int errno_save = errno;					\
-		switch (process_stopped(pid))				\
-		case 0:							\
-		case -1: {						\
+		if (errno == ESRCH) {					\
 			debug(DEBUG_EVENT,				\
 			      "process not stopped, is it terminating?"); \
 			event.type = EVENT_NONE;			\
 			continue_process(event.proc->pid);		\
 			return &event;					\
 		}							\
-		errno = errno_save;					\
 	} while (0)
 
 	event.proc->instruction_pointer = (void *)(uintptr_t)-1;
@@ -243,6 +702,37 @@ next_event(void)
 		return &event;
 	}
 
+	/* Seized tasks report both stops requested by
+	 * PTRACE_INTERRUPT and group-stops as PTRACE_EVENT_STOP.
+	 * Our interrupts are presented as SIGSTOP, so that the
+	 * stopping handlers can sink them the same way as the
+	 * SIGSTOPs sent to tasks that were not seized.  Group-stops
+	 * are left in place by PTRACE_LISTEN, so that job control
+	 * keeps working.  */
+	if (WIFSTOPPED(status) && status >> 16 == PTRACE_EVENT_STOP) {
+		if (event.proc->os.interrupt_pending) {
+			event.proc->os.interrupt_pending = 0;
+			event.type = EVENT_SIGNAL;
+			event.e_un.signum = SIGSTOP;
+			debug(DEBUG_EVENT, "event: INTERRUPT: pid=%d", pid);
+			return &event;
+		}
+
+		stop_signal = WSTOPSIG(status);
+		if (stop_signal == SIGSTOP || stop_signal == SIGTSTP
+		    || stop_signal == SIGTTIN || stop_signal == SIGTTOU) {
+			/* A SIGCONT lets the task run without us
+			 * resuming it.  */
+			linux_mem_cache_flush();
+			ptrace(PTRACE_LISTEN, pid, 0, 0);
+		} else
+			continue_process(pid);
+		event.type = EVENT_NONE;
+		debug(DEBUG_EVENT, "event: NONE: pid=%d (group-stop %d)",
+		      pid, stop_signal);
+		return &event;
+	}
+
 	event.proc->instruction_pointer = get_instruction_pointer(event.proc);
 	if (event.proc->instruction_pointer == (void *)(uintptr_t)-1) {
 		CHECK_PROCESS_TERMINATED;
@@ -315,6 +805,10 @@ next_event(void)
 	   in the test suite tests this.  Petr Machata 2011-06-08.  */
 	void * break_address
 		= event.proc->instruction_pointer - DECR_PC_AFTER_BREAK;
+	arch_addr_t hw_address;
+	if (stop_signal == SIGTRAP && options.hw_breakpoints
+	    && arch_hw_breakpoint_hit(event.proc, &hw_address))
+		break_address = hw_address;
 	if ((stop_signal == SIGSEGV || stop_signal == SIGILL)
 	    && leader != NULL
 	    && address2bpstruct(leader, break_address))
@@ -337,19 +831,34 @@ next_event(void)
 	return &event;
 }
 
-static enum ecb_status
-event_for_proc(struct Event *event, void *data)
-{
-	if (event->proc == data)
-		return ECB_DEQUE;
-	else
-		return ECB_CONT;
-}
-
 void
 delete_events_for(struct process *proc)
 {
-	struct Event *event;
-	while ((event = each_qd_event(&event_for_proc, proc)) != NULL)
-		free(event);
+	size_t i;
+	for (i = harvest_next; i < harvest_count; ++i)
+		if (harvest[i].pid == proc->pid)
+			harvest[i].pid = 0;
+
+	struct qd_task *task = qd_task_find(proc->pid);
+	if (task == NULL)
+		return;
+
+	Event *prev = NULL;
+	Event *event;
+	for (event = task->head; event != NULL; ) {
+		Event *next = event->next;
+		if (event->proc == proc) {
+			qd_task_unlink(task, prev, event);
+			qd_event_release(event);
+		} else {
+			prev = event;
+		}
+		event = next;
+	}
+
+	/* The task is going away, forget about it.  */
+	if (task->head == NULL) {
+		dict_remove(qd_tasks, (void *)(uintptr_t)proc->pid);
+		free(task);
+	}
 }
@@ -21,6 +21,8 @@
 #ifndef SYSDEPS_LINUX_GNU_EVENTS_H
 #define SYSDEPS_LINUX_GNU_EVENTS_H
 
+#include <sys/types.h>
+
 #include "forward.h"
 
 /* Declarations for event que functions.  */
@@ -33,9 +35,27 @@ enum ecb_status {
 		    * from the queue.  */
 };
 
+/* Iterate through all queued events.  Events of one task are visited
+ * in the order in which they were queued, tasks are visited in the
+ * order in which their first pending event was queued.  */
 struct Event *each_qd_event(enum ecb_status (*cb)(struct Event *event,
 						  void *data), void *data);
+
+/* Like each_qd_event, but only visit events queued for task PID.  */
+struct Event *each_qd_event_for(pid_t pid,
+				enum ecb_status (*cb)(struct Event *event,
+						      void *data),
+				void *data);
+
+/* Answer whether there are any events queued for task PID.  */
+int have_events_for(pid_t pid);
+
 void delete_events_for(struct process *proc);
 void enque_event(struct Event *event);
 
+/* Called in a freshly forked tracer to give it its own copy of the
+ * event loop.  Timers are re-armed, other watched descriptors are
+ * closed and forgotten.  */
+void linux_event_loop_forked(void);
+
 #endif /* SYSDEPS_LINUX_GNU_EVENTS_H */
@@ -26,6 +26,7 @@
 
 #include "proc.h"
 #include "common.h"
+#include "linux-gnu/trace.h"
 
 #if (!defined(PTRACE_PEEKUSER) && defined(PTRACE_PEEKUSR))
 # define PTRACE_PEEKUSER PTRACE_PEEKUSR
@@ -62,5 +63,6 @@ get_return_addr(struct process *proc, void *stack_pointer)
 void
 set_return_addr(struct process *proc, void *addr)
 {
+	linux_mem_cache_flush();
 	ptrace(PTRACE_POKETEXT, proc->pid, proc->stack_pointer, addr);
 }
@@ -19,7 +19,16 @@
  */
 
 #define OS_HAVE_PROCESS_DATA
+struct linux_maps;
 struct os_process_data {
 	arch_addr_t debug_addr;
 	int debug_state;
+
+	/* Set when we asked the task to stop by PTRACE_INTERRUPT,
+	 * and the corresponding stop was not reported yet.  */
+	int interrupt_pending;
+
+	/* Mapped address ranges, see os_address_mapped.  Only used
+	 * in the leader, NULL until first needed.  */
+	struct linux_maps *maps;
 };
@@ -540,6 +540,7 @@ unresolve_plt_slot(struct process *proc, GElf_Addr addr, GElf_Addr value)
 	 * address of the routine.  We keep the TOC and environment
 	 * pointers intact.  Hence the only adjustment that we need to
 	 * do is to IP.  */
+	linux_mem_cache_flush();
 	if (ptrace(PTRACE_POKETEXT, proc->pid, addr, value) < 0) {
 		fprintf(stderr, "failed to unresolve .plt slot: %s\n",
 			strerror(errno));
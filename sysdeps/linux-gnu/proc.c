@@ -47,6 +47,8 @@
 #include "library.h"
 #include "ltrace-elf.h"
 #include "proc.h"
+#include "vect.h"
+#include "linux-gnu/trace.h"
 
 /* /proc/pid doesn't exist just after the fork, and sometimes `ltrace'
  * couldn't open it to find the executable.  So it may be necessary to
@@ -59,6 +61,34 @@
 	char VAR[strlen(FORMAT) + 6];		\
 	sprintf(VAR, FORMAT, PID)
 
+/* The mapped ranges of a process, as read from /proc/PID/maps,
+ * sorted and with adjacent ranges merged.  The list is read again
+ * when it is needed after the process could have changed its
+ * address space: after a system call that maps or unmaps memory, an
+ * exec, or a change of the dynamic linker's link map.  */
+struct linux_maps {
+	struct vect ranges; /* Of struct maps_range.  */
+	int stale;
+};
+
+struct maps_range {
+	uint64_t start;
+	uint64_t end;
+
+	/* Whether this is the main stack, which the kernel extends
+	 * downward without telling us.  */
+	int stack;
+};
+
+static void
+maps_destroy(struct linux_maps *maps)
+{
+	if (maps == NULL)
+		return;
+	VECT_DESTROY(&maps->ranges, struct maps_range, NULL, NULL);
+	free(maps);
+}
+
 /*
  * Returns a (malloc'd) file name corresponding to a running pid
  */
@@ -591,6 +621,10 @@ rdebug_bp_on_hit(struct breakpoint *bp, struct process *proc)
 		}
 	}
 
+	/* The dynamic linker maps and unmaps the libraries.  */
+	if (proc->leader->os.maps != NULL)
+		proc->leader->os.maps->stale = 1;
+
 	proc->os.debug_state = rdbg.r_state;
 }
 
@@ -711,23 +745,162 @@ os_process_init(struct process *proc)
 {
 	proc->os.debug_addr = 0;
 	proc->os.debug_state = 0;
+	proc->os.interrupt_pending = 0;
+	proc->os.maps = NULL;
 	return 0;
 }
 
 void
 os_process_destroy(struct process *proc)
 {
+	maps_destroy(proc->os.maps);
+	proc->os.maps = NULL;
 }
 
 int
 os_process_clone(struct process *retp, struct process *proc)
 {
 	retp->os = proc->os;
+	retp->os.interrupt_pending = 0;
+	retp->os.maps = NULL;
 	return 0;
 }
 
 int
 os_process_exec(struct process *proc)
 {
+	if (proc->os.maps != NULL)
+		proc->os.maps->stale = 1;
 	return 0;
 }
+
+/* Read the ranges of process PID.  If that fails, the list is left
+ * empty, and is not read again until it goes stale the next time.  */
+static void
+maps_read(struct linux_maps *maps, pid_t pid)
+{
+	vect_destroy(&maps->ranges, NULL, NULL);
+	VECT_INIT(&maps->ranges, struct maps_range);
+	maps->stale = 0;
+
+	PROC_PID_FILE(fn, "/proc/%d/maps", pid);
+	FILE *file = fopen(fn, "r");
+	if (file == NULL)
+		return;
+
+	char *line = NULL;
+	size_t line_len = 0;
+	while (getline(&line, &line_len, file) >= 0) {
+		struct maps_range range = {};
+		int pos = 0;
+		if (sscanf(line, "%" SCNx64 "-%" SCNx64 " %n",
+			   &range.start, &range.end, &pos) < 2)
+			continue;
+		range.stack = strstr(line + pos, "[stack]") != NULL;
+
+		/* The ranges come sorted, so only look at the last
+		 * one when merging.  */
+		if (!vect_empty(&maps->ranges)) {
+			struct maps_range *last
+				= VECT_BACK(&maps->ranges, struct maps_range);
+			if (last->end == range.start && !range.stack) {
+				last->end = range.end;
+				continue;
+			}
+		}
+		if (VECT_PUSHBACK(&maps->ranges, &range) < 0) {
+			vect_destroy(&maps->ranges, NULL, NULL);
+			VECT_INIT(&maps->ranges, struct maps_range);
+			break;
+		}
+	}
+
+	free(line);
+	fclose(file);
+}
+
+/* Look up the LEN bytes at ADDR in MAPS, with the same return
+ * values as os_address_mapped.  */
+static int
+maps_lookup(struct linux_maps *maps, arch_addr_t addr, size_t len)
+{
+	/* Every process has something mapped, so an empty list means
+	 * that it couldn't be read.  */
+	if (vect_empty(&maps->ranges))
+		return -1;
+
+	uint64_t start = (uint64_t)(uintptr_t)addr;
+	uint64_t end = start + (len > 0 ? len : 1);
+
+	/* Find the first range that ends past START.  */
+	size_t lo = 0, hi = vect_size(&maps->ranges);
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (VECT_ELEMENT(&maps->ranges, struct maps_range,
+				 mid)->end <= start)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == vect_size(&maps->ranges))
+		return 0;
+
+	struct maps_range *range
+		= VECT_ELEMENT(&maps->ranges, struct maps_range, lo);
+	if (range->start <= start)
+		return end <= range->end ? 1 : 0;
+
+	/* Below the main stack, this may be memory that it will grow
+	 * into, or has grown into since we last looked.  */
+	return range->stack ? -1 : 0;
+}
+
+int
+os_address_mapped(struct process *proc, arch_addr_t addr, size_t len)
+{
+	struct process *leader = proc->leader;
+	if (leader->os.maps == NULL) {
+		leader->os.maps = malloc(sizeof(*leader->os.maps));
+		if (leader->os.maps == NULL)
+			return -1;
+		VECT_INIT(&leader->os.maps->ranges, struct maps_range);
+		leader->os.maps->stale = 1;
+	}
+
+	struct linux_maps *maps = leader->os.maps;
+	int fresh = maps->stale;
+	if (fresh)
+		maps_read(maps, leader->pid);
+
+	int ret = maps_lookup(maps, addr, len);
+
+	/* The list can miss a change that we didn't see happen, such
+	 * as a system call made while the process wasn't stopped at
+	 * system calls, so don't answer "no" from an old list.  */
+	if (ret == 0 && !fresh) {
+		maps_read(maps, leader->pid);
+		ret = maps_lookup(maps, addr, len);
+	}
+	return ret;
+}
+
+void
+os_process_sysret(struct process *proc, const char *name)
+{
+	static const char *const names[] = {
+		"brk", "mmap", "mmap2", "mremap", "munmap",
+		"remap_file_pages", "shmat", "shmdt", "io_setup",
+		"io_destroy",
+	};
+
+	struct linux_maps *maps = proc->leader->os.maps;
+	if (maps == NULL || maps->stale || name == NULL)
+		return;
+
+	size_t i;
+	for (i = 0; i < sizeof names / sizeof names[0]; ++i)
+		if (strcmp(name, names[i]) == 0) {
+			maps->stale = 1;
+			return;
+		}
+}
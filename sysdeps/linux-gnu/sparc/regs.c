@@ -25,6 +25,7 @@
 #include "ptrace.h"
 #include "proc.h"
 #include "common.h"
+#include "linux-gnu/trace.h"
 
 void *
 get_instruction_pointer(struct process *proc)
@@ -72,5 +73,6 @@ set_return_addr(struct process *proc, void *addr)
 	proc_archdep *a = (proc_archdep *) (proc->arch_ptr);
 	if (!a->valid)
 		return;
+	linux_mem_cache_flush();
 	ptrace(PTRACE_POKETEXT, proc->pid, a->regs.u_regs[UREG_I6] + 8, addr);
 }
@@ -35,6 +35,18 @@
 # define PTRACE_GETEVENTMSG      0x4201
 #endif
 
+#ifndef PTRACE_SEIZE
+# define PTRACE_SEIZE            0x4206
+#endif
+
+#ifndef PTRACE_INTERRUPT
+# define PTRACE_INTERRUPT        0x4207
+#endif
+
+#ifndef PTRACE_LISTEN
+# define PTRACE_LISTEN           0x4208
+#endif
+
 /* Options set using PTRACE_SETOPTIONS.  */
 #ifndef PTRACE_O_TRACESYSGOOD
 # define PTRACE_O_TRACESYSGOOD   0x00000001
@@ -89,4 +101,9 @@
 # define PTRACE_EVENT_EXIT       6
 #endif
 
+/* Reported for PTRACE_INTERRUPT and group-stops of seized tasks.  */
+#ifndef PTRACE_EVENT_STOP
+# define PTRACE_EVENT_STOP       128
+#endif
+
 #endif /* _TRACE_DEFS_H_ */
@@ -21,13 +21,17 @@
  * 02110-1301 USA
  */
 
+#define _GNU_SOURCE /* For process_vm_readv.  */
 #include "config.h"
 
 #include <asm/unistd.h>
+#include <linux/capability.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 #include <assert.h>
 #include <errno.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,9 +45,9 @@
 #include "linux-gnu/trace-defs.h"
 #include "backend.h"
 #include "breakpoint.h"
+#include "common.h"
 #include "debug.h"
 #include "events.h"
-#include "options.h"
 #include "proc.h"
 #include "ptrace.h"
 #include "type.h"
@@ -104,8 +108,21 @@ trace_pid(pid_t pid)
 	/* This shouldn't emit error messages, as there are legitimate
 	 * reasons that the PID can't be attached: like it may have
 	 * already ended.  */
-	if (ptrace(PTRACE_ATTACH, pid, 0, 0) < 0)
+
+	/* Prefer PTRACE_SEIZE, which doesn't send SIGSTOP to the
+	 * task.  Tasks attached this way (and their auto-attached
+	 * children) can be stopped by PTRACE_INTERRUPT, see
+	 * send_sigstop.  Kernels older than 3.4 answer EIO, in which
+	 * case fall back to PTRACE_ATTACH.  */
+	if (ptrace(PTRACE_SEIZE, pid, 0, 0) == 0) {
+		if (ptrace(PTRACE_INTERRUPT, pid, 0, 0) < 0) {
+			untrace_pid(pid);
+			return -1;
+		}
+	} else if (errno != EIO
+		   || ptrace(PTRACE_ATTACH, pid, 0, 0) < 0) {
 		return -1;
+	}
 
 	return wait_for_proc(pid);
 }
@@ -133,6 +150,7 @@ trace_set_options(struct process *proc)
 void
 untrace_pid(pid_t pid) {
 	debug(DEBUG_PROCESS, "untrace_pid: pid=%d", pid);
+	linux_mem_cache_flush();
 	ptrace(PTRACE_DETACH, pid, 0, 0);
 }
 
@@ -141,23 +159,10 @@ continue_after_signal(pid_t pid, int signum)
 {
 	debug(DEBUG_PROCESS, "continue_after_signal: pid=%d, signum=%d",
 	      pid, signum);
+	linux_mem_cache_flush();
 	ptrace(PTRACE_SYSCALL, pid, 0, (void *)(uintptr_t)signum);
 }
 
-static enum ecb_status
-event_for_pid(Event *event, void *data)
-{
-	if (event->proc != NULL && event->proc->pid == (pid_t)(uintptr_t)data)
-		return ECB_YIELD;
-	return ECB_CONT;
-}
-
-static int
-have_events_for(pid_t pid)
-{
-	return each_qd_event(event_for_pid, (void *)(uintptr_t)pid) != NULL;
-}
-
 void
 continue_process(pid_t pid)
 {
@@ -166,11 +171,12 @@ continue_process(pid_t pid)
 	/* Only really continue the process if there are no events in
 	   the queue for this process.  Otherwise just wait for the
 	   other events to arrive.  */
-	if (!have_events_for(pid))
+	if (!have_events_for(pid)) {
 		/* We always trace syscalls to control fork(),
 		 * clone(), execve()... */
+		linux_mem_cache_flush();
 		ptrace(PTRACE_SYSCALL, pid, 0, 0);
-	else
+	} else
 		debug(DEBUG_PROCESS,
 		      "putting off the continue, events in que.");
 }
@@ -237,7 +243,7 @@ task_blocked(struct process *task, void *data)
 	struct pid_set *pids = data;
 	struct pid_task *task_info = get_task_info(pids, task->pid);
 	if (task_info != NULL
-	    && task_info->vforked)
+	    && (task_info->vforked || task_info->delivered))
 		return CBS_CONT;
 
 	return task_stopped(task, NULL);
@@ -305,7 +311,14 @@ send_sigstop(struct process *task, void *data)
 		return CBS_CONT;
 	}
 
-	if (task_kill(task->pid, SIGSTOP) >= 0) {
+	/* Seized tasks can be stopped without sending them a
+	 * signal.  For tasks that were attached by PTRACE_ATTACH or
+	 * PTRACE_TRACEME, PTRACE_INTERRUPT fails with EIO.  */
+	if (ptrace(PTRACE_INTERRUPT, task->pid, 0, 0) == 0) {
+		debug(DEBUG_PROCESS, "interrupt %d", task->pid);
+		task->os.interrupt_pending = 1;
+		task_info->sigstopped = 1;
+	} else if (task_kill(task->pid, SIGSTOP) >= 0) {
 		debug(DEBUG_PROCESS, "send SIGSTOP to %d", task->pid);
 		task_info->sigstopped = 1;
 	} else
@@ -329,6 +342,7 @@ ugly_workaround(struct process *proc)
 		enable_breakpoint(proc, sbp);
 	else
 		insert_breakpoint(proc, ip, NULL);
+	linux_mem_cache_flush();
 	ptrace(PTRACE_CONT, proc->pid, 0, 0);
 }
 
@@ -404,10 +418,19 @@ retract_breakpoint_cb(struct process *proc, struct breakpoint *bp, void *data)
 	return CBS_CONT;
 }
 
+static enum callback_status
+undo_breakpoints_of_task(struct process *task, void *data)
+{
+	each_qd_event_for(task->pid, &undo_breakpoint, data);
+	if (options.hw_breakpoints)
+		arch_hw_breakpoints_disable(task);
+	return CBS_CONT;
+}
+
 static void
 detach_process(struct process *leader)
 {
-	each_qd_event(&undo_breakpoint, leader);
+	each_task(leader, NULL, &undo_breakpoints_of_task, leader);
 	disable_all_breakpoints(leader);
 	proc_each_breakpoint(leader, NULL, retract_breakpoint_cb, NULL);
 
@@ -472,6 +495,7 @@ continue_for_sigstop_delivery(struct pid_set *pids)
 		    && pids->tasks[i].got_event) {
 			debug(DEBUG_PROCESS, "continue %d for SIGSTOP delivery",
 			      pids->tasks[i].pid);
+			linux_mem_cache_flush();
 			ptrace(PTRACE_SYSCALL, pids->tasks[i].pid, 0, 0);
 		}
 	}
@@ -504,6 +528,7 @@ await_sigstop_delivery(struct pid_set *pids, struct pid_task *task_info,
 		/* We should get the signal the first thing
 		 * after this, so it should be OK to continue
 		 * even if we are over a breakpoint.  */
+		linux_mem_cache_flush();
 		ptrace(PTRACE_SYSCALL, task_info->pid, 0, 0);
 
 	} else {
@@ -540,6 +565,60 @@ all_stops_accountable(struct pid_set *pids)
 	return 1;
 }
 
+#ifndef ARCH_HAVE_EMULATE_BREAKPOINT
+int
+arch_emulate_breakpoint(struct process *proc, struct breakpoint *bp)
+{
+	return -1;
+}
+#endif
+
+#ifndef ARCH_HAVE_HW_BREAKPOINTS
+int
+arch_hw_breakpoint_promote(struct process *leader, struct breakpoint *bp)
+{
+	return -1;
+}
+
+int
+arch_hw_breakpoint_hit(struct process *task, arch_addr_t *addrp)
+{
+	return 0;
+}
+
+int
+arch_hw_breakpoint_p(struct breakpoint *bp)
+{
+	return 0;
+}
+
+void
+arch_hw_breakpoints_enable(struct process *task)
+{
+}
+
+void
+arch_hw_breakpoints_disable(struct process *task)
+{
+}
+#endif
+
+/* With --hw-breakpoints, breakpoints of library symbols that had to
+ * be stepped over this many times are moved to debug registers.  */
+#define HW_BREAKPOINT_STEPOVERS 64
+
+/* Called when all tasks of LEADER are stopped and BP was stepped
+ * over.  Returns 1 if BP was moved to hardware, 0 if it should be
+ * put back to memory.  */
+static int
+promote_breakpoint(struct process *leader, struct breakpoint *bp)
+{
+	if (!options.hw_breakpoints || bp->libsym == NULL
+	    || ++bp->stepovers < HW_BREAKPOINT_STEPOVERS)
+		return 0;
+	return arch_hw_breakpoint_promote(leader, bp) == 0;
+}
+
 #ifndef ARCH_HAVE_SW_SINGLESTEP
 enum sw_singlestep_status
 arch_sw_singlestep(struct process *proc, struct breakpoint *bp,
@@ -610,6 +689,9 @@ singlestep(struct process_stopping_handler *self)
 {
 	struct process *proc = self->task_enabling_breakpoint;
 
+	/* The task is resumed one way or another.  */
+	linux_mem_cache_flush();
+
 	struct sw_singlestep_data data = { self };
 	switch (arch_sw_singlestep(self->task_enabling_breakpoint,
 				   self->breakpoint_being_enabled,
@@ -663,6 +745,7 @@ pt_continue(struct process_stopping_handler *self)
 {
 	struct process *teb = self->task_enabling_breakpoint;
 	debug(1, "PTRACE_CONT");
+	linux_mem_cache_flush();
 	ptrace(PTRACE_CONT, teb->pid, 0, 0);
 }
 
@@ -794,7 +877,7 @@ process_stopping_on_event(struct event_handler *super, Event *event)
 			/* Re-enable the breakpoint that we are
 			 * stepping over.  */
 			struct breakpoint *sbp = self->breakpoint_being_enabled;
-			if (sbp->enabled)
+			if (sbp->enabled && !promote_breakpoint(leader, sbp))
 				enable_breakpoint(teb, sbp);
 
 			post_singlestep(self, &event);
@@ -896,6 +979,34 @@ process_install_stopping_handler(struct process *proc, struct breakpoint *sbp,
 	return 0;
 }
 
+struct return_addr_data {
+	struct process *proc;
+	arch_addr_t addr;
+};
+
+static enum callback_status
+task_returns_to(struct process *task, void *data)
+{
+	struct return_addr_data *rad = data;
+	if (task == rad->proc)
+		return CBS_CONT;
+
+	size_t i;
+	for (i = 0; i < task->callstack_depth; ++i)
+		if (task->callstack[i].return_addr == rad->addr)
+			return CBS_STOP;
+	return CBS_CONT;
+}
+
+/* Whether SBP is a return breakpoint that other tasks than PROC are
+ * still waiting for.  */
+static int
+return_breakpoint_shared(struct process *proc, struct breakpoint *sbp)
+{
+	struct return_addr_data rad = { proc, sbp->addr };
+	return each_task(proc->leader, NULL, &task_returns_to, &rad) != NULL;
+}
+
 void
 continue_after_breakpoint(struct process *proc, struct breakpoint *sbp)
 {
@@ -912,8 +1023,18 @@ continue_after_breakpoint(struct process *proc, struct breakpoint *sbp)
 		/* we don't want to singlestep here */
 		continue_process(proc->pid);
 #else
-		if (process_install_stopping_handler
-		    (proc, sbp, NULL, NULL, NULL) < 0) {
+		/* If the instruction under the breakpoint can be
+		 * emulated, the breakpoint stays in place, and the
+		 * other tasks don't need to be stopped.  But a return
+		 * breakpoint that other tasks wait for may be deleted
+		 * and inserted again while this one runs, and it could
+		 * then hit it with no call left to return from.  So
+		 * stop everyone in that case.  */
+		if (!return_breakpoint_shared(proc, sbp)
+		    && arch_emulate_breakpoint(proc, sbp) == 0)
+			continue_process(proc->pid);
+		else if (process_install_stopping_handler
+			 (proc, sbp, NULL, NULL, NULL) < 0) {
 			perror("process_stopping_handler_create");
 			/* Carry on not bothering to re-enable.  */
 			continue_process(proc->pid);
@@ -1118,6 +1239,205 @@ continue_after_vfork(struct process *proc)
 	change_process_leader(proc, proc->parent->leader);
 }
 
+/* PIDs of the tracers that split_tracer forked off.  These are our
+ * children, so their termination shows up in next_event.  */
+static struct {
+	pid_t *pids;
+	size_t count;
+	size_t alloc;
+} split_tracers;
+
+int
+have_split_tracers(void)
+{
+	return split_tracers.count > 0;
+}
+
+int
+reap_split_tracer(pid_t pid)
+{
+	size_t i;
+	for (i = 0; i < split_tracers.count; ++i)
+		if (split_tracers.pids[i] == pid) {
+			split_tracers.pids[i]
+				= split_tracers.pids[--split_tracers.count];
+			return 1;
+		}
+	return 0;
+}
+
+static enum callback_status
+forget_other_process(struct process *proc, void *data)
+{
+	/* The original tracer keeps tracing these.  */
+	if (proc != data)
+		remove_process(proc);
+	return CBS_CONT;
+}
+
+/* Attach to PID, which the original tracer has detached with a
+ * SIGSTOP pending.  Depending on whether that SIGSTOP was delivered
+ * yet, the task reports either the signal, or, being stopped
+ * already, a group-stop.  Either way there's exactly one stop to
+ * collect, and the SIGSTOP is gone once the task is continued
+ * without a signal.  (With PTRACE_ATTACH, which is only used on
+ * kernels older than 3.4, the second SIGSTOP may show up in the
+ * trace.)  */
+static int
+take_over_task(pid_t pid)
+{
+	if (ptrace(PTRACE_SEIZE, pid, 0, 0) < 0
+	    && (errno != EIO || ptrace(PTRACE_ATTACH, pid, 0, 0) < 0))
+		return -1;
+	return wait_for_proc(pid);
+}
+
+static int
+have_cap_sys_ptrace(void)
+{
+	FILE *stream = fopen("/proc/self/status", "r");
+	if (stream == NULL)
+		return 0;
+
+	char line[256];
+	unsigned long long caps = 0;
+	while (fgets(line, sizeof(line), stream) != NULL)
+		if (sscanf(line, "CapEff: %llx", &caps) == 1)
+			break;
+	fclose(stream);
+	return (caps & (1ULL << CAP_SYS_PTRACE)) != 0;
+}
+
+int
+os_check_split_tracers(void)
+{
+	/* With Yama ptrace_scope of 1, only descendants can be
+	 * attached to without CAP_SYS_PTRACE.  2 needs the
+	 * capability for any attach, 3 disables attaching.  */
+	FILE *stream = fopen("/proc/sys/kernel/yama/ptrace_scope", "r");
+	if (stream == NULL)
+		return 0;
+	int scope;
+	if (fscanf(stream, "%d", &scope) != 1)
+		scope = 0;
+	fclose(stream);
+
+	if (scope <= 0 || (scope < 3 && have_cap_sys_ptrace()))
+		return 0;
+
+	fprintf(stderr,
+"Option --split-tracers can't be used: the Yama ptrace_scope setting %d\n"
+"doesn't allow ltrace to take over processes that it didn't start.  See\n"
+"/proc/sys/kernel/yama/ptrace_scope.\n", scope);
+	return -1;
+}
+
+static void
+reopen_split_output(pid_t pid)
+{
+	size_t len = strlen(options.output_name) + sizeof(pid_t) * 3 + 2;
+	char *name = malloc(len);
+	if (name != NULL)
+		snprintf(name, len, "%s.%d", options.output_name, pid);
+	if (name == NULL || output_reopen(name) < 0)
+		fprintf(stderr, "can't open %s for writing: %s\n",
+			name != NULL ? name : options.output_name,
+			strerror(errno));
+	free(name);
+}
+
+int
+split_tracer(struct process *proc)
+{
+	debug(DEBUG_PROCESS, "split_tracer: pid=%d", proc->pid);
+	assert(proc->leader == proc);
+	pid_t pid = proc->pid;
+
+	if (split_tracers.count == split_tracers.alloc) {
+		size_t alloc = split_tracers.alloc > 0
+			? 2 * split_tracers.alloc : 4;
+		pid_t *pids = realloc(split_tracers.pids,
+				      alloc * sizeof(*pids));
+		if (pids == NULL)
+			return -1;
+		split_tracers.pids = pids;
+		split_tracers.alloc = alloc;
+	}
+
+	/* The new tracer must not attach before we detach.  It
+	 * waits until we close our end of this pipe.  */
+	int fds[2];
+	if (pipe(fds) < 0)
+		return -1;
+
+	/* Finish any unfinished line, and don't let both tracers
+	 * write out the buffered output.  */
+	output_line(NULL, NULL);
+	fflush(options.output);
+
+	pid_t tracer = fork();
+	if (tracer < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+
+	if (tracer > 0) {
+		close(fds[0]);
+
+		/* Take the breakpoints out, so that the task isn't
+		 * left with them if the new tracer fails to take
+		 * over.  The new tracer puts them back.  Queue a
+		 * SIGSTOP, so that the task stops again before it gets
+		 * to run untraced.  */
+		disable_all_breakpoints(proc);
+		if (options.hw_breakpoints)
+			arch_hw_breakpoints_disable(proc);
+		task_kill(pid, SIGSTOP);
+		untrace_pid(pid);
+		close(fds[1]);
+
+		split_tracers.pids[split_tracers.count++] = tracer;
+		remove_process(proc);
+		return 0;
+	}
+
+	char c;
+	close(fds[1]);
+	while (read(fds[0], &c, 1) < 0 && errno == EINTR)
+		;
+	close(fds[0]);
+
+	each_process(NULL, &forget_other_process, proc);
+	linux_event_loop_forked();
+	split_tracers.count = 0;
+	proc->parent = NULL;
+	proc->os.interrupt_pending = 0;
+	proc->tracesysgood &= ~0x80;
+
+	/* Statistics gathered so far belong to the original
+	 * tracer.  */
+	drop_summary();
+
+	if (options.output_name != NULL)
+		reopen_split_output(pid);
+
+	if (take_over_task(pid) < 0) {
+		/* The task has no breakpoints in it, let it run on
+		 * untraced rather than leave it stopped.  */
+		fprintf(stderr, "Couldn't take over tracing of PID %d: %s\n",
+			pid, strerror(errno));
+		kill(pid, SIGCONT);
+		exit(1);
+	}
+	trace_set_options(proc);
+	enable_all_breakpoints(proc);
+	if (options.hw_breakpoints)
+		arch_hw_breakpoints_enable(proc);
+	continue_process(pid);
+	return 1;
+}
+
 static int
 is_mid_stopping(struct process *proc)
 {
@@ -1193,6 +1513,98 @@ os_ltrace_exiting_sighandler(void)
 	return 0;
 }
 
+#ifdef HAVE_PROCESS_VM_READV
+/* Memory read from stopped tasks is kept in a small cache of whole
+ * pages.  When a call is formatted, the same memory is often read
+ * several times, e.g. a string is first scanned for its terminator
+ * and then displayed, and this way it is only fetched once.  Tasks
+ * of a process share their memory, so the whole cache is dropped
+ * each time that any task is resumed or that memory is written
+ * to.  */
+#define MEM_CACHE_SLOTS 16
+
+static struct mem_cache_slot {
+	pid_t pid;
+	uintptr_t page;
+	unsigned generation;
+	unsigned char *data;
+} mem_cache[MEM_CACHE_SLOTS];
+
+static unsigned mem_cache_generation = 1;
+static size_t mem_cache_page_size = 0;
+static int have_vm_readv = 1;
+
+void
+linux_mem_cache_flush(void)
+{
+	if (++mem_cache_generation == 0) {
+		/* Make sure that no stale slot matches after the
+		 * wrap-around.  */
+		size_t i;
+		for (i = 0; i < MEM_CACHE_SLOTS; ++i)
+			mem_cache[i].generation = 0;
+		mem_cache_generation = 1;
+	}
+}
+
+static unsigned char *
+mem_cache_page(pid_t pid, uintptr_t page)
+{
+	struct mem_cache_slot *slot
+		= &mem_cache[(page / mem_cache_page_size) % MEM_CACHE_SLOTS];
+	if (slot->generation == mem_cache_generation
+	    && slot->pid == pid && slot->page == page)
+		return slot->data;
+
+	slot->generation = 0;
+	if (slot->data == NULL
+	    && (slot->data = malloc(mem_cache_page_size)) == NULL)
+		return NULL;
+
+	struct iovec local = { slot->data, mem_cache_page_size };
+	struct iovec remote = { (void *)page, mem_cache_page_size };
+	ssize_t rd = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+	if (rd < 0 || (size_t)rd != mem_cache_page_size) {
+		if (rd < 0 && errno == ENOSYS)
+			have_vm_readv = 0;
+		return NULL;
+	}
+
+	slot->pid = pid;
+	slot->page = page;
+	slot->generation = mem_cache_generation;
+	return slot->data;
+}
+
+/* Copy LEN bytes at ADDR in task PID to LADDR through the cache.
+ * Returns the number of bytes copied, which is less than LEN if a
+ * page couldn't be read.  */
+static size_t
+mem_cache_read(pid_t pid, void *addr, void *laddr, size_t len)
+{
+	size_t done = 0;
+	while (done < len) {
+		uintptr_t a = (uintptr_t)addr + done;
+		uintptr_t page = a - a % mem_cache_page_size;
+		unsigned char *data = mem_cache_page(pid, page);
+		if (data == NULL)
+			break;
+
+		size_t n = mem_cache_page_size - (a - page);
+		if (n > len - done)
+			n = len - done;
+		memcpy(laddr + done, data + (a - page), n);
+		done += n;
+	}
+	return done;
+}
+#else
+void
+linux_mem_cache_flush(void)
+{
+}
+#endif
+
 size_t
 umovebytes(struct process *proc, void *addr, void *laddr, size_t len)
 {
@@ -1204,7 +1616,41 @@ umovebytes(struct process *proc, void *addr, void *laddr, size_t len)
 	int started = 0;
 	size_t offset = 0, bytes_read = 0;
 
+#ifdef HAVE_PROCESS_VM_READV
+	if (mem_cache_page_size == 0) {
+		long ps = sysconf(_SC_PAGESIZE);
+		mem_cache_page_size = ps > 0 ? (size_t)ps : 4096;
+	}
+
+	/* Reads of up to a page go through the cache, larger ones are
+	 * done in one go.  Either way, a short read means that the
+	 * block runs into memory that is not readable, and
+	 * PTRACE_PEEKTEXT then picks up the word that straddles the
+	 * boundary.  */
+	if (have_vm_readv && len <= mem_cache_page_size) {
+		offset = bytes_read
+			= mem_cache_read(proc->pid, addr, laddr, len);
+		if (offset == len)
+			return len;
+		started = offset > 0;
+	} else if (have_vm_readv) {
+		struct iovec local = { laddr, len };
+		struct iovec remote = { addr, len };
+		ssize_t rd = process_vm_readv(proc->pid, &local, 1,
+					      &remote, 1, 0);
+		if (rd >= 0 && (size_t)rd == len)
+			return len;
+		if (rd > 0) {
+			offset = bytes_read = rd;
+			started = 1;
+		} else if (rd < 0 && errno == ENOSYS) {
+			have_vm_readv = 0;
+		}
+	}
+#endif
+
 	while (offset < len) {
+		errno = 0;
 		a.a = ptrace(PTRACE_PEEKTEXT, proc->pid, addr + offset, 0);
 		if (a.a == -1 && errno) {
 			if (started && errno == EIO)
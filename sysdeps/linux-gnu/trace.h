@@ -118,4 +118,17 @@ int process_install_stopping_handler
 void linux_ptrace_disable_and_singlestep(struct process_stopping_handler *self);
 void linux_ptrace_disable_and_continue(struct process_stopping_handler *self);
 
+/* Forget inferior memory cached by umovebytes.  This has to be
+ * called before any task is resumed, and after inferior memory is
+ * written to.  */
+void linux_mem_cache_flush(void);
+
+/* Whether there are tracers created by split_tracer that haven't
+ * terminated yet.  */
+int have_split_tracers(void);
+
+/* If PID is one of the tracers created by split_tracer, forget about
+ * it and return 1.  Otherwise return 0.  */
+int reap_split_tracer(pid_t pid);
+
 #endif /* _LTRACE_LINUX_TRACE_H_ */
@@ -26,6 +26,25 @@
 #define ARCH_HAVE_FETCH_ARG
 #define ARCH_HAVE_SIZEOF
 #define ARCH_HAVE_ALIGNOF
+#define ARCH_HAVE_EMULATE_BREAKPOINT
+#define ARCH_HAVE_HW_BREAKPOINTS
+
+#define ARCH_HAVE_BREAKPOINT_DATA
+struct arch_breakpoint_data {
+	/* Debug register that realizes the breakpoint, or -1 if it's
+	 * in memory.  */
+	int dr;
+	/* Process in whose tasks DR was set, or NULL.  */
+	struct process *leader;
+};
+
+#define ARCH_HAVE_TYPE_DATA
+struct arch_type_data {
+	/* x86_64 classes of a structure type, see classify_argument.
+	 * NUM_CLASSES is zero until they are computed.  */
+	int num_classes;
+	int classes[2];
+};
 #define ARCH_ENDIAN_LITTLE
 
 #ifdef __x86_64__
@@ -539,6 +539,25 @@ classify_argument(struct process *proc, struct fetch_context *context,
 
 		if (has_nontrivial_ctor_dtor(info))
 			return pass_by_reference(valuep, classes);
+
+		/* The classes of a structure only depend on its type,
+		 * so remember them.  Flattening and classifying it on
+		 * each call is comparatively expensive.  */
+		ssize_t i;
+		if (info->arch.num_classes > 0) {
+			for (i = 0; i < info->arch.num_classes; ++i)
+				classes[i] = info->arch.classes[i];
+			return info->arch.num_classes;
+		}
+
+		ssize_t num_classes = classify(proc, context, info, valuep,
+					       classes, sz, eightbytes);
+		if (num_classes > 0 && num_classes <= 2) {
+			for (i = 0; i < num_classes; ++i)
+				info->arch.classes[i] = classes[i];
+			info->arch.num_classes = num_classes;
+		}
+		return num_classes;
 	}
 
 	return classify(proc, context, info, valuep, classes, sz, eightbytes);
@@ -841,6 +860,11 @@ arch_fetch_retval(struct fetch_context *context, enum tof type,
 	return arch_fetch_fun_retval(context, type, proc, info, valuep);
 }
 
+void
+arch_type_destroy(struct arg_type_info *info)
+{
+}
+
 void
 arch_fetch_arg_done(struct fetch_context *context)
 {
@@ -30,6 +30,7 @@
 
 #include "backend.h"
 #include "proc.h"
+#include "linux-gnu/trace.h"
 
 #if (!defined(PTRACE_PEEKUSER) && defined(PTRACE_PEEKUSR))
 # define PTRACE_PEEKUSER PTRACE_PEEKUSR
@@ -113,5 +114,6 @@ set_return_addr(struct process *proc, void *addr)
 {
 	if (proc->e_machine == EM_386)
 		addr = (void *)((long int)addr & 0xffffffff);
+	linux_mem_cache_flush();
 	ptrace(PTRACE_POKETEXT, proc->pid, proc->stack_pointer, addr);
 }
@@ -26,13 +26,19 @@
 #include <sys/wait.h>
 #include <assert.h>
 #include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "backend.h"
+#include "breakpoint.h"
 #include "debug.h"
 #include "proc.h"
 #include "ptrace.h"
 #include "type.h"
+#include "linux-gnu/trace.h"
 
 #if (!defined(PTRACE_PEEKUSER) && defined(PTRACE_PEEKUSR))
 # define PTRACE_PEEKUSER PTRACE_PEEKUSR
@@ -189,3 +195,443 @@ arch_type_alignof(struct process *proc, struct arg_type_info *info)
 		return (size_t)-2;
 	}
 }
+
+/* Instructions that are commonly found under breakpoints--at PLT
+ * entries and at function entry points--are simple enough that we
+ * can apply their effect to registers and memory of the task
+ * ourselves.  Then we don't need to singlestep over them, which
+ * means removing the breakpoint for a while and stopping all other
+ * tasks meanwhile.  */
+
+struct x86_emulation {
+	uint64_t ip;	/* Where to continue.  */
+	int push;	/* Whether to push VALUE.  */
+	uint64_t value;
+	int sub_sp;	/* Whether to subtract VALUE from SP.  */
+};
+
+#ifdef __x86_64__
+# define EMU_IP rip
+# define EMU_SP rsp
+#else
+# define EMU_IP eip
+# define EMU_SP esp
+#endif
+
+static uint64_t
+emulate_get_reg(struct user_regs_struct *regs, unsigned no)
+{
+	switch (no) {
+#ifdef __x86_64__
+	case 0: return regs->rax;
+	case 1: return regs->rcx;
+	case 2: return regs->rdx;
+	case 3: return regs->rbx;
+	case 4: return regs->rsp;
+	case 5: return regs->rbp;
+	case 6: return regs->rsi;
+	case 7: return regs->rdi;
+	case 8: return regs->r8;
+	case 9: return regs->r9;
+	case 10: return regs->r10;
+	case 11: return regs->r11;
+	case 12: return regs->r12;
+	case 13: return regs->r13;
+	case 14: return regs->r14;
+	case 15: return regs->r15;
+#else
+	case 0: return (uint32_t)regs->eax;
+	case 1: return (uint32_t)regs->ecx;
+	case 2: return (uint32_t)regs->edx;
+	case 3: return (uint32_t)regs->ebx;
+	case 4: return (uint32_t)regs->esp;
+	case 5: return (uint32_t)regs->ebp;
+	case 6: return (uint32_t)regs->esi;
+	case 7: return (uint32_t)regs->edi;
+#endif
+	}
+	abort();
+}
+
+static int32_t
+emulate_imm32(const unsigned char *buf)
+{
+	return (int32_t)((uint32_t)buf[0] | (uint32_t)buf[1] << 8
+			 | (uint32_t)buf[2] << 16 | (uint32_t)buf[3] << 24);
+}
+
+/* Decode the instruction in INSN (LEN bytes are valid), which sits at
+ * address IP.  Returns 0 and fills in EMU if it's one of the
+ * instructions that we know how to emulate, or a negative value
+ * otherwise.  */
+static int
+emulate_decode(struct process *proc, struct user_regs_struct *regs,
+	       const unsigned char *insn, size_t len, uint64_t ip,
+	       struct x86_emulation *emu)
+{
+	int is_64 = proc->e_machine == EM_X86_64;
+	uint64_t mask = is_64 ? (uint64_t)-1 : 0xffffffff;
+	memset(emu, 0, sizeof(*emu));
+
+	/* endbr64, endbr32.  */
+	if (len >= 4 && insn[0] == 0xf3 && insn[1] == 0x0f
+	    && insn[2] == 0x1e && (insn[3] == 0xfa || insn[3] == 0xfb)) {
+		emu->ip = ip + 4;
+		return 0;
+	}
+
+	/* jmp *disp32(%rip) on x86_64, jmp *disp32 on i386, possibly
+	 * with a bnd prefix.  This is what PLT entries do.  On i386,
+	 * PIC PLT entries do jmp *disp32(%ebx) instead.  */
+	size_t p = len > 0 && insn[0] == 0xf2 ? 1 : 0;
+	if (len >= p + 6 && insn[p] == 0xff
+	    && (insn[p + 1] == 0x25 || (!is_64 && insn[p + 1] == 0xa3))) {
+		int32_t disp = emulate_imm32(insn + p + 2);
+		uint64_t addr;
+		if (is_64)
+			addr = ip + p + 6 + (int64_t)disp;
+		else if (insn[p + 1] == 0xa3)
+			addr = (emulate_get_reg(regs, 3) + disp) & mask;
+		else
+			addr = (uint32_t)disp;
+
+		size_t word = is_64 ? 8 : 4;
+		uint64_t target = 0;
+		if (umovebytes(proc, (arch_addr_t)(uintptr_t)addr,
+			       &target, word) != word)
+			return -1;
+		emu->ip = target & mask;
+		return 0;
+	}
+
+	unsigned rex = 0;
+	p = 0;
+	if (is_64 && len > 0 && (insn[0] & 0xf0) == 0x40)
+		rex = insn[p++];
+
+	/* push %reg.  Only REX.B may be present.  */
+	if (len > p && (insn[p] & 0xf8) == 0x50 && (rex & ~0x41) == 0) {
+		unsigned reg = (insn[p] & 7) | (rex & 1) << 3;
+		emu->ip = ip + p + 1;
+		emu->push = 1;
+		emu->value = emulate_get_reg(regs, reg) & mask;
+		return 0;
+	}
+
+	/* sub $imm8, %rsp and sub $imm32, %rsp.  64-bit operand size
+	 * is required on x86_64, so that the result is not
+	 * truncated.  */
+	if (rex != (is_64 ? 0x48 : 0) || len < p + 2 || insn[p + 1] != 0xec)
+		return -1;
+	if (insn[p] == 0x83 && len >= p + 3) {
+		emu->ip = ip + p + 3;
+		emu->value = (uint64_t)(int64_t)(int8_t)insn[p + 2] & mask;
+	} else if (insn[p] == 0x81 && len >= p + 6) {
+		emu->ip = ip + p + 6;
+		emu->value = (uint64_t)(int64_t)emulate_imm32(insn + p + 2)
+			& mask;
+	} else {
+		return -1;
+	}
+	emu->sub_sp = 1;
+	return 0;
+}
+
+/* Compute the arithmetic flags of RES = DST - SRC.  */
+static unsigned long
+emulate_sub_flags(uint64_t dst, uint64_t src, uint64_t res, uint64_t mask)
+{
+	uint64_t sign = (mask >> 1) + 1;
+	unsigned long flags = 0;
+	unsigned parity = res & 0xff;
+	parity ^= parity >> 4;
+	parity ^= parity >> 2;
+	parity ^= parity >> 1;
+
+	if (dst < src)
+		flags |= 0x1;		/* CF */
+	if (!(parity & 1))
+		flags |= 0x4;		/* PF */
+	if ((dst ^ src ^ res) & 0x10)
+		flags |= 0x10;		/* AF */
+	if (res == 0)
+		flags |= 0x40;		/* ZF */
+	if (res & sign)
+		flags |= 0x80;		/* SF */
+	if ((dst ^ src) & (dst ^ res) & sign)
+		flags |= 0x800;		/* OF */
+	return flags;
+}
+
+/* Store SIZE low-order bytes of VALUE at ADDR.  */
+static int
+emulate_poke(struct process *proc, uint64_t addr, uint64_t value, size_t size)
+{
+	void *ptr = (void *)(uintptr_t)addr;
+	long word = (long)value;
+	if (size < sizeof(long)) {
+		errno = 0;
+		word = ptrace(PTRACE_PEEKDATA, proc->pid, ptr, 0);
+		if (word == -1 && errno != 0)
+			return -1;
+		unsigned long keep = ~0UL << (8 * size);
+		word = (long)(((unsigned long)word & keep)
+			      | ((unsigned long)value & ~keep));
+	}
+	linux_mem_cache_flush();
+	return ptrace(PTRACE_POKEDATA, proc->pid, ptr, (void *)word) < 0
+		? -1 : 0;
+}
+
+/* The resume flag, which suppresses instruction breakpoints in the
+ * debug registers for the next instruction.  */
+#define EFLAGS_RF 0x10000
+
+int
+arch_emulate_breakpoint(struct process *proc, struct breakpoint *bp)
+{
+	/* Set the resume flag, so that the instruction is simply
+	 * executed when the task is continued, instead of hitting the
+	 * debug register again.  The kernel sets it itself only when
+	 * the stop was the hit of the register, not when this was a
+	 * queued hit of the int3 that was there before.  */
+	if (bp->arch.dr >= 0) {
+		struct user_regs_struct regs;
+		if (ptrace(PTRACE_GETREGS, proc->pid, 0, &regs) < 0)
+			return -1;
+		regs.eflags |= EFLAGS_RF;
+		if (ptrace(PTRACE_SETREGS, proc->pid, 0, &regs) < 0)
+			return -1;
+		return 0;
+	}
+
+	unsigned char insn[8];
+	size_t len = umovebytes(proc, bp->addr, insn, sizeof(insn));
+	if (len == (size_t)-1 || len == 0)
+		return -1;
+	if (len > sizeof(insn))
+		len = sizeof(insn);
+	memcpy(insn, bp->orig_value, BREAKPOINT_LENGTH);
+
+	struct user_regs_struct regs;
+	if (ptrace(PTRACE_GETREGS, proc->pid, 0, &regs) < 0)
+		return -1;
+
+	struct x86_emulation emu;
+	uint64_t ip = (uintptr_t)bp->addr;
+	if (emulate_decode(proc, &regs, insn, len, ip, &emu) < 0)
+		return -1;
+
+	int is_64 = proc->e_machine == EM_X86_64;
+	size_t word = is_64 ? 8 : 4;
+	uint64_t mask = is_64 ? (uint64_t)-1 : 0xffffffff;
+	uint64_t sp = emulate_get_reg(&regs, 4) & mask;
+
+	if (emu.push) {
+		sp = (sp - word) & mask;
+		if (emulate_poke(proc, sp, emu.value, word) < 0)
+			return -1;
+	} else if (emu.sub_sp) {
+		uint64_t res = (sp - emu.value) & mask;
+		regs.eflags &= ~0x8d5UL;
+		regs.eflags |= emulate_sub_flags(sp, emu.value, res, mask);
+		sp = res;
+	}
+
+	debug(DEBUG_PROCESS, "emulated instruction at %p, continuing at %#llx",
+	      bp->addr, (unsigned long long)emu.ip);
+	regs.EMU_SP = sp;
+	regs.EMU_IP = emu.ip;
+	if (ptrace(PTRACE_SETREGS, proc->pid, 0, &regs) < 0) {
+		/* The stack was already written to, but only below
+		 * SP, where it doesn't matter.  */
+		return -1;
+	}
+	return 0;
+}
+
+/* Breakpoints that are hit a lot can be moved to debug registers
+ * DR0-DR3.  Those are per-task, but the breakpoint is either in all
+ * tasks of a process, or in none.  Breakpoint memory stays untouched
+ * while in a debug register.  */
+
+#define DR_OFFSET(I) offsetof(struct user, u_debugreg[I])
+#define DR_STATUS 6
+#define DR_CONTROL 7
+#define DR_COUNT 4
+
+static int
+set_debugreg(pid_t pid, int i, unsigned long value)
+{
+	return ptrace(PTRACE_POKEUSER, pid, DR_OFFSET(i), value) < 0 ? -1 : 0;
+}
+
+/* Point debug register I of TASK at ADDR and enable it, or disable
+ * it if ADDR is 0.  */
+static int
+hw_breakpoint_set(struct process *task, int i, arch_addr_t addr)
+{
+	errno = 0;
+	long dr7 = ptrace(PTRACE_PEEKUSER, task->pid, DR_OFFSET(DR_CONTROL), 0);
+	if (dr7 == -1 && errno != 0)
+		return -1;
+
+	/* Local enable bit.  Zero R/W and LEN bits mean a one-byte
+	 * instruction breakpoint.  */
+	dr7 &= ~(0xfUL << (16 + 4 * i) | 3UL << (2 * i));
+	if (addr == 0)
+		return set_debugreg(task->pid, DR_CONTROL, dr7);
+
+	dr7 |= 1UL << (2 * i);
+	if (set_debugreg(task->pid, i, (uintptr_t)addr) < 0
+	    || set_debugreg(task->pid, DR_CONTROL, dr7) < 0)
+		return -1;
+	return 0;
+}
+
+static enum callback_status
+used_debugregs_cb(struct process *proc, struct breakpoint *bp, void *data)
+{
+	if (bp->arch.dr >= 0)
+		*(unsigned *)data |= 1 << bp->arch.dr;
+	return CBS_CONT;
+}
+
+struct hw_breakpoint_data {
+	int i;
+	arch_addr_t addr;
+};
+
+static enum callback_status
+hw_breakpoint_set_cb(struct process *task, void *data)
+{
+	struct hw_breakpoint_data *hbd = data;
+	return hw_breakpoint_set(task, hbd->i, hbd->addr) < 0
+		? CBS_STOP : CBS_CONT;
+}
+
+static enum callback_status
+hw_breakpoint_clear_cb(struct process *task, void *data)
+{
+	/* Tasks that are gone can't be cleared, but don't need to
+	 * be either.  */
+	hw_breakpoint_set(task, *(int *)data, 0);
+	return CBS_CONT;
+}
+
+int
+arch_breakpoint_init(struct process *proc, struct breakpoint *sbp)
+{
+	sbp->arch.dr = -1;
+	sbp->arch.leader = NULL;
+	return 0;
+}
+
+void
+arch_breakpoint_destroy(struct breakpoint *sbp)
+{
+	/* Free the debug register, or it would keep firing in code
+	 * that is mapped at that address later.  Tasks of a process
+	 * that is being removed have their LEADER cleared, and
+	 * each_task then doesn't visit them.  */
+	if (sbp->arch.dr >= 0 && sbp->arch.leader != NULL)
+		each_task(sbp->arch.leader, NULL, &hw_breakpoint_clear_cb,
+			  &sbp->arch.dr);
+}
+
+int
+arch_breakpoint_clone(struct breakpoint *retp, struct breakpoint *sbp)
+{
+	/* Debug registers are not inherited, arch_hw_breakpoints_enable
+	 * sets them up in the new process.  */
+	retp->arch.dr = sbp->arch.dr;
+	retp->arch.leader = NULL;
+	return 0;
+}
+
+int
+arch_hw_breakpoint_promote(struct process *leader, struct breakpoint *bp)
+{
+	assert(leader->leader == leader);
+	assert(bp->arch.dr < 0);
+
+	unsigned used = 0;
+	proc_each_breakpoint(leader, NULL, &used_debugregs_cb, &used);
+	int i;
+	for (i = 0; i < DR_COUNT; ++i)
+		if (!(used & (1 << i)))
+			break;
+	if (i == DR_COUNT)
+		return -1;
+
+	struct hw_breakpoint_data hbd = { i, bp->addr };
+	if (each_task(leader, NULL, &hw_breakpoint_set_cb, &hbd) != NULL) {
+		/* Roll back in the tasks where it worked.  */
+		hbd.addr = 0;
+		each_task(leader, NULL, &hw_breakpoint_set_cb, &hbd);
+		return -1;
+	}
+
+	debug(DEBUG_PROCESS, "breakpoint %s@%p moved to DR%d",
+	      breakpoint_name(bp), bp->addr, i);
+	bp->arch.dr = i;
+	bp->arch.leader = leader;
+	return 0;
+}
+
+int
+arch_hw_breakpoint_p(struct breakpoint *bp)
+{
+	return bp->arch.dr >= 0;
+}
+
+int
+arch_hw_breakpoint_hit(struct process *task, arch_addr_t *addrp)
+{
+	errno = 0;
+	long dr6 = ptrace(PTRACE_PEEKUSER, task->pid, DR_OFFSET(DR_STATUS), 0);
+	if ((dr6 == -1 && errno != 0) || (dr6 & 0xf) == 0)
+		return 0;
+
+	/* The kernel accumulates the status bits, so clear them.  */
+	set_debugreg(task->pid, DR_STATUS, 0);
+
+	int i;
+	for (i = 0; !(dr6 & (1 << i)); ++i)
+		;
+	errno = 0;
+	long addr = ptrace(PTRACE_PEEKUSER, task->pid, DR_OFFSET(i), 0);
+	if (addr == -1 && errno != 0)
+		return 0;
+
+	*addrp = (arch_addr_t)addr;
+	return 1;
+}
+
+static enum callback_status
+hw_breakpoint_enable_cb(struct process *proc, struct breakpoint *bp,
+			void *data)
+{
+	struct process *task = data;
+	if (bp->arch.dr < 0)
+		return CBS_CONT;
+	if (hw_breakpoint_set(task, bp->arch.dr, bp->addr) < 0)
+		fprintf(stderr, "Couldn't set DR%d of %d to %p: %s\n",
+			bp->arch.dr, task->pid, bp->addr, strerror(errno));
+	bp->arch.leader = proc;
+	return CBS_CONT;
+}
+
+void
+arch_hw_breakpoints_enable(struct process *task)
+{
+	if (task->leader != NULL)
+		proc_each_breakpoint(task->leader, NULL,
+				     &hw_breakpoint_enable_cb, task);
+}
+
+void
+arch_hw_breakpoints_disable(struct process *task)
+{
+	set_debugreg(task->pid, DR_CONTROL, 0);
+}
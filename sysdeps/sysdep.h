@@ -63,4 +63,9 @@ struct arch_process_data {
 };
 #endif
 
+#ifndef ARCH_HAVE_TYPE_DATA
+struct arch_type_data {
+};
+#endif
+
 #endif /* LTRACE_SYSDEP_H */
@@ -21,12 +21,15 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 
 #include "type.h"
 #include "sysdep.h"
+#include "backend.h"
 #include "expr.h"
 #include "lens.h"
+#include "proc.h"
 
 struct arg_type_info *
 type_get_simple(enum arg_type type)
@@ -59,12 +62,21 @@ type_get_simple(enum arg_type type)
 	abort();
 }
 
+#ifndef ARCH_HAVE_TYPE_DATA
+void
+arch_type_destroy(struct arg_type_info *info)
+{
+}
+#endif
+
 static void
 type_init_common(struct arg_type_info *info, enum arg_type type)
 {
 	info->type = type;
 	info->lens = NULL;
 	info->own_lens = 0;
+	info->layout = NULL;
+	memset(&info->arch, 0, sizeof(info->arch));
 }
 
 struct struct_field {
@@ -85,6 +97,10 @@ type_struct_add(struct arg_type_info *info,
 {
 	assert(info->type == ARGTYPE_STRUCT);
 	struct struct_field field = { field_info, own };
+	free(info->layout);
+	info->layout = NULL;
+	arch_type_destroy(info);
+	memset(&info->arch, 0, sizeof(info->arch));
 	return VECT_PUSHBACK(&info->u.entries, &field);
 }
 
@@ -120,40 +136,64 @@ type_struct_destroy(struct arg_type_info *info)
 {
 	VECT_DESTROY(&info->u.entries, struct struct_field,
 		     struct_field_dtor, NULL);
+	free(info->layout);
+	info->layout = NULL;
 }
 
+/* Sizes and alignments of types depend on the architecture of the
+ * traced process, so a layout is only valid for processes of the
+ * same kind as the one that it was computed for.  */
+struct struct_layout {
+	int have_proc;
+	short e_machine;
+	unsigned int personality;
+
+	size_t size;
+	size_t alignment;
+	size_t offsets[];
+};
+
 static int
-layout_struct(struct process *proc, struct arg_type_info *info,
-	      size_t *sizep, size_t *alignmentp, size_t *offsetofp)
+layout_matches(struct struct_layout *layout, struct process *proc)
 {
+	if (proc == NULL)
+		return !layout->have_proc;
+	return layout->have_proc
+		&& layout->e_machine == proc->e_machine
+		&& layout->personality == proc->personality;
+}
+
+static struct struct_layout *
+layout_struct(struct process *proc, struct arg_type_info *info)
+{
+	assert(info->type == ARGTYPE_STRUCT);
+	if (info->layout != NULL && layout_matches(info->layout, proc))
+		return info->layout;
+
+	size_t n = vect_size(&info->u.entries);
+	struct struct_layout *layout
+		= malloc(sizeof(*layout) + n * sizeof(layout->offsets[0]));
+	if (layout == NULL)
+		return NULL;
+
 	size_t sz = 0;
 	size_t max_alignment = 0;
 	size_t i;
-	size_t offsetof_field = (size_t)-1;
-	if (offsetofp != NULL)
-		offsetof_field = *offsetofp;
-
-	assert(info->type == ARGTYPE_STRUCT);
-	for (i = 0; i < vect_size(&info->u.entries); ++i) {
+	for (i = 0; i < n; ++i) {
 		struct struct_field *field
 			= VECT_ELEMENT(&info->u.entries,
 				       struct struct_field, i);
 
 		size_t alignment = type_alignof(proc, field->info);
-		if (alignment == (size_t)-1)
-			return -1;
+		size_t size = type_sizeof(proc, field->info);
+		if (alignment == (size_t)-1 || size == (size_t)-1) {
+			free(layout);
+			return NULL;
+		}
 
 		/* Add padding to SZ to align the next element.  */
 		sz = align(sz, alignment);
-		if (i == offsetof_field) {
-			*offsetofp = sz;
-			if (sizep == NULL && alignmentp == NULL)
-				return 0;
-		}
-
-		size_t size = type_sizeof(proc, field->info);
-		if (size == (size_t)-1)
-			return -1;
+		layout->offsets[i] = sz;
 		sz += size;
 
 		if (alignment > max_alignment)
@@ -163,13 +203,15 @@ layout_struct(struct process *proc, struct arg_type_info *info,
 	if (max_alignment > 0)
 		sz = align(sz, max_alignment);
 
-	if (sizep != NULL)
-		*sizep = sz;
-
-	if (alignmentp != NULL)
-		*alignmentp = max_alignment;
+	layout->have_proc = proc != NULL;
+	layout->e_machine = proc != NULL ? proc->e_machine : 0;
+	layout->personality = proc != NULL ? proc->personality : 0;
+	layout->size = sz;
+	layout->alignment = max_alignment;
 
-	return 0;
+	free(info->layout);
+	info->layout = layout;
+	return layout;
 }
 
 void
@@ -251,6 +293,8 @@ type_destroy(struct arg_type_info *info)
 		lens_destroy(info->lens);
 		free(info->lens);
 	}
+
+	arch_type_destroy(info);
 }
 
 #ifdef ARCH_HAVE_SIZEOF
@@ -296,7 +340,7 @@ type_sizeof(struct process *proc, struct arg_type_info *type)
 		return arch_size;
 
 	switch (type->type) {
-		size_t size;
+		struct struct_layout *layout;
 	case ARGTYPE_CHAR:
 		return sizeof(char);
 
@@ -319,9 +363,10 @@ type_sizeof(struct process *proc, struct arg_type_info *type)
 		return sizeof(double);
 
 	case ARGTYPE_STRUCT:
-		if (layout_struct(proc, type, &size, NULL, NULL) < 0)
+		layout = layout_struct(proc, type);
+		if (layout == NULL)
 			return (size_t)-1;
-		return size;
+		return layout->size;
 
 	case ARGTYPE_POINTER:
 		return sizeof(void *);
@@ -382,7 +427,7 @@ type_alignof(struct process *proc, struct arg_type_info *type)
 	static size_t double_alignment = alignof(d, cd);
 
 	switch (type->type) {
-		size_t alignment;
+		struct struct_layout *layout;
 	case ARGTYPE_LONG:
 	case ARGTYPE_ULONG:
 		return long_alignment;
@@ -402,9 +447,10 @@ type_alignof(struct process *proc, struct arg_type_info *type)
 		return type_alignof(proc, type->u.array_info.elt_type);
 
 	case ARGTYPE_STRUCT:
-		if (layout_struct(proc, type, NULL, &alignment, NULL) < 0)
+		layout = layout_struct(proc, type);
+		if (layout == NULL)
 			return (size_t)-1;
-		return alignment;
+		return layout->alignment;
 
 	default:
 		return int_alignment;
@@ -420,6 +466,7 @@ type_offsetof(struct process *proc, struct arg_type_info *type, size_t emt)
 	switch (type->type) {
 		size_t alignment;
 		size_t size;
+		struct struct_layout *layout;
 	case ARGTYPE_ARRAY:
 		alignment = type_alignof(proc, type->u.array_info.elt_type);
 		if (alignment == (size_t)-1)
@@ -432,9 +479,10 @@ type_offsetof(struct process *proc, struct arg_type_info *type, size_t emt)
 		return emt * align(size, alignment);
 
 	case ARGTYPE_STRUCT:
-		if (layout_struct(proc, type, NULL, NULL, &emt) < 0)
+		layout = layout_struct(proc, type);
+		if (layout == NULL || emt >= type_struct_size(type))
 			return (size_t)-1;
-		return emt;
+		return layout->offsets[emt];
 
 	default:
 		abort();
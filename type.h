@@ -24,6 +24,7 @@
 
 #include <stddef.h>
 #include "forward.h"
+#include "sysdep.h"
 #include "vect.h"
 
 enum arg_type {
@@ -64,6 +65,12 @@ struct arg_type_info {
 
 	struct lens *lens;
 	int own_lens;
+
+	/* ARGTYPE_STRUCT: layout computed by type_sizeof and friends,
+	 * or NULL if it wasn't computed yet.  */
+	struct struct_layout *layout;
+
+	struct arch_type_data arch;
 };
 
 /* Return a type info for simple type TYPE (which shall not be array,
@@ -77,7 +84,12 @@ struct arg_type_info *type_get_simple(enum arg_type type);
 void type_init_struct(struct arg_type_info *info);
 
 /* Add a new field of type FIELD_INFO to a structure INFO.  If OWN,
- * the field type is owned and destroyed together with INFO.  */
+ * the field type is owned and destroyed together with INFO.
+ *
+ * The layout of a structure is computed once, when it is first
+ * needed, and then reused.  Adding a field drops the layout of INFO,
+ * but not of structures that contain INFO, so types have to be fully
+ * built before they are used.  */
 int type_struct_add(struct arg_type_info *info,
 		    struct arg_type_info *field_info, int own);
 
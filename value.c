@@ -22,12 +22,37 @@
 #include <assert.h>
 #include <stdlib.h>
 
+#include "arena.h"
 #include "value.h"
 #include "type.h"
 #include "common.h"
 #include "expr.h"
 #include "backend.h"
 
+/* Where value_alloc takes memory from, see value_set_arena.  */
+static struct arena *value_arena = NULL;
+
+struct arena *
+value_set_arena(struct arena *arena)
+{
+	struct arena *old = value_arena;
+	value_arena = arena;
+	return old;
+}
+
+/* Allocate SIZE bytes of data for a value, and set *LOCP to the
+ * location that the value should have.  */
+static void *
+value_alloc(size_t size, enum value_location_t *locp)
+{
+	if (value_arena != NULL) {
+		*locp = VAL_LOC_ARENA;
+		return arena_alloc(value_arena, size);
+	}
+	*locp = VAL_LOC_COPY;
+	return malloc(size);
+}
+
 static void
 value_common_init(struct value *valp, struct process *inferior,
 		  struct value *parent, struct arg_type_info *type,
@@ -106,10 +131,13 @@ value_reserve(struct value *valp, size_t size)
 		valp->where = VAL_LOC_WORD;
 		valp->u.value = 0;
 	} else {
-		valp->where = VAL_LOC_COPY;
-		valp->u.address = calloc(size, 1);
-		if (valp->u.address == 0)
+		enum value_location_t nloc;
+		void *data = value_alloc(size, &nloc);
+		if (data == NULL)
 			return NULL;
+		memset(data, 0, size);
+		valp->where = nloc;
+		valp->u.address = data;
 	}
 	return value_get_raw_data(valp);
 }
@@ -139,10 +167,9 @@ value_reify(struct value *val, struct value_dict *arguments)
 		data = &val->u.value;
 		nloc = VAL_LOC_WORD;
 	} else {
-		data = malloc(size);
+		data = value_alloc(size, &nloc);
 		if (data == NULL)
 			return -1;
-		nloc = VAL_LOC_COPY;
 	}
 
 	if (umovebytes(val->inferior, val->u.inf_address, data, size) < size) {
@@ -152,7 +179,7 @@ value_reify(struct value *val, struct value_dict *arguments)
 	}
 
 	val->where = nloc;
-	if (nloc == VAL_LOC_COPY)
+	if (nloc != VAL_LOC_WORD)
 		val->u.address = data;
 
 	return 0;
@@ -176,6 +203,7 @@ value_get_raw_data(struct value *val)
 		return NULL;
 	case VAL_LOC_COPY:
 	case VAL_LOC_SHARED:
+	case VAL_LOC_ARENA:
 		return val->u.address;
 	case VAL_LOC_WORD:
 		return val->u.buf;
@@ -189,7 +217,7 @@ int
 value_clone(struct value *retp, const struct value *val)
 {
 	*retp = *val;
-	if (val->where == VAL_LOC_COPY) {
+	if (val->where == VAL_LOC_COPY || val->where == VAL_LOC_ARENA) {
 		assert(val->inferior != NULL);
 		size_t size = type_sizeof(val->inferior, val->type);
 		if (size == (size_t)-1)
@@ -200,6 +228,7 @@ value_clone(struct value *retp, const struct value *val)
 			return -1;
 
 		memcpy(retp->u.address, val->u.address, size);
+		retp->where = VAL_LOC_COPY;
 	}
 
 	return 0;
@@ -250,6 +279,7 @@ value_init_element(struct value *ret_val, struct value *val, size_t element)
 	switch (val->where) {
 	case VAL_LOC_COPY:
 	case VAL_LOC_SHARED:
+	case VAL_LOC_ARENA:
 		ret_val->u.address = val->u.address + off;
 		ret_val->where = VAL_LOC_SHARED;
 		return 0;
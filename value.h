@@ -42,6 +42,8 @@ enum value_location_t {
 	VAL_LOC_COPY,		/* Value was copied out of the inferior.  */
 	VAL_LOC_SHARED,		/* Like VAL_LOC_COPY, but don't free.  */
 	VAL_LOC_WORD,		/* Like VAL_LOC_COPY, but small enough.  */
+	VAL_LOC_ARENA,		/* Like VAL_LOC_SHARED, but the data is
+				 * owned by an arena.  */
 };
 
 struct value {
@@ -50,7 +52,8 @@ struct value {
 	struct value *parent;
 	size_t size;
 	union {
-		void *address;  /* VAL_LOC_COPY, VAL_LOC_SHARED */
+		void *address;  /* VAL_LOC_COPY, VAL_LOC_SHARED,
+				 * VAL_LOC_ARENA */
 		arch_addr_t inf_address;  /* VAL_LOC_INFERIOR */
 		long value;     /* VAL_LOC_WORD */
 		unsigned char buf[0];
@@ -104,6 +107,12 @@ void value_set_word(struct value *valp, long value);
  * may be allocated by malloc.  Returns NULL on failure.  */
 unsigned char *value_reserve(struct value *valp, size_t size);
 
+/* Make value_reserve and value_reify allocate from ARENA instead of
+ * by malloc, or by malloc again if ARENA is NULL.  Data of such
+ * values stays valid until ARENA is reset, value_clone makes a
+ * malloc'd copy.  Returns the arena that was used before.  */
+struct arena *value_set_arena(struct arena *arena);
+
 /* Access ELEMENT-th field of the compound value VALP, and store the
  * result into the value RET_VAL.  Returns 0 on success, or negative
  * value on failure.  */
@@ -27,11 +27,44 @@
 
 struct named_value
 {
-	const char *name;
 	struct value value;
-	int own_name;
+	int present;
 };
 
+/* Interned names, indexed by their identifiers.  */
+static struct vect names;
+static int names_initialized;
+
+static int
+find_name(const char *name)
+{
+	size_t i;
+	for (i = 0; i < vect_size(&names); ++i)
+		if (strcmp(*VECT_ELEMENT(&names, char *, i), name) == 0)
+			return i;
+	return -1;
+}
+
+int
+val_dict_intern(const char *name)
+{
+	if (!names_initialized) {
+		VECT_INIT(&names, char *);
+		names_initialized = 1;
+	}
+
+	int id = find_name(name);
+	if (id >= 0)
+		return id;
+
+	char *copy = strdup(name);
+	if (copy == NULL || VECT_PUSHBACK(&names, &copy) < 0) {
+		free(copy);
+		return -1;
+	}
+	return vect_size(&names) - 1;
+}
+
 void
 val_dict_init(struct value_dict *dict)
 {
@@ -55,23 +88,17 @@ static int
 named_value_clone(struct named_value *tgt,
 		  const struct named_value *src, void *data)
 {
-	tgt->name = strdup(src->name);
-	if (tgt->name == NULL)
-		return -1;
-	tgt->own_name = 1;
-	if (value_clone(&tgt->value, &src->value) < 0) {
-		free((char *)tgt->name);
-		return -1;
-	}
-	return 0;
+	tgt->present = src->present;
+	if (!src->present)
+		return 0;
+	return value_clone(&tgt->value, &src->value);
 }
 
 static void
 named_value_dtor(struct named_value *named, void *data)
 {
-	if (named->own_name)
-		free((char *)named->name);
-	value_destroy(&named->value);
+	if (named->present)
+		value_destroy(&named->value);
 }
 
 int
@@ -97,20 +124,32 @@ val_dict_push_next(struct value_dict *dict, struct value *val)
 }
 
 int
-val_dict_push_named(struct value_dict *dict, struct value *val,
-		    const char *name, int own_name)
+val_dict_push_id(struct value_dict *dict, struct value *val, int id)
 {
-	if (own_name && (name = strdup(name)) == NULL)
-		return -1;
-	struct named_value element = { name, *val, own_name };
-	if (VECT_PUSHBACK(&dict->named, &element) < 0) {
-		if (own_name)
-			free((char *)name);
+	if (id < 0)
 		return -1;
+
+	while (vect_size(&dict->named) <= (size_t)id) {
+		struct named_value empty = { .present = 0 };
+		if (VECT_PUSHBACK(&dict->named, &empty) < 0)
+			return -1;
 	}
+
+	struct named_value *element
+		= VECT_ELEMENT(&dict->named, struct named_value, (size_t)id);
+	named_value_dtor(element, NULL);
+	element->value = *val;
+	element->present = 1;
 	return 0;
 }
 
+int
+val_dict_push_named(struct value_dict *dict, struct value *val,
+		    const char *name)
+{
+	return val_dict_push_id(dict, val, val_dict_intern(name));
+}
+
 size_t
 val_dict_count(struct value_dict *dict)
 {
@@ -124,17 +163,20 @@ val_dict_get_num(struct value_dict *dict, size_t num)
 	return VECT_ELEMENT(&dict->numbered, struct value, num);
 }
 
+struct value *
+val_dict_get_id(struct value_dict *dict, int id)
+{
+	if (id < 0 || (size_t)id >= vect_size(&dict->named))
+		return NULL;
+	struct named_value *element
+		= VECT_ELEMENT(&dict->named, struct named_value, (size_t)id);
+	return element->present ? &element->value : NULL;
+}
+
 struct value *
 val_dict_get_name(struct value_dict *dict, const char *name)
 {
-	size_t i;
-	for (i = 0; i < vect_size(&dict->named); ++i) {
-		struct named_value *element
-			= VECT_ELEMENT(&dict->named, struct named_value, i);
-		if (strcmp(element->name, name) == 0)
-			return &element->value;
-	}
-	return NULL;
+	return val_dict_get_id(dict, find_name(name));
 }
 
 void
@@ -25,13 +25,20 @@
 #include "vect.h"
 
 /* Value dictionary is used to store actual function arguments.  It
- * supports both numbered and named arguments.  */
+ * supports both numbered and named arguments.  Names are interned to
+ * small integer identifiers, and named values are kept in slots
+ * indexed by them.  */
 struct value_dict
 {
 	struct vect numbered;
 	struct vect named;
 };
 
+/* Return identifier of NAME.  The same identifier is returned for
+ * all equal names, and it can be passed to val_dict_push_id and
+ * val_dict_get_id.  Returns a negative value on failure.  */
+int val_dict_intern(const char *name);
+
 /* Initialize DICT.  */
 void val_dict_init(struct value_dict *dict);
 
@@ -48,10 +55,16 @@ int val_dict_push_next(struct value_dict *dict, struct value *val);
 size_t val_dict_count(struct value_dict *dict);
 
 /* Push value VAL named NAME.  See notes at val_dict_push_next about
- * value ownership.  The name is owned and freed if OWN_NAME is
- * non-zero.  */
+ * value ownership.  NAME is interned, the caller keeps ownership of
+ * it.  */
 int val_dict_push_named(struct value_dict *dict, struct value *val,
-			const char *name, int own_name);
+			const char *name);
+
+/* Push value VAL named by identifier ID, as returned by
+ * val_dict_intern.  If a value of that name is already in DICT, it
+ * is destroyed and replaced by VAL.  See notes at val_dict_push_next
+ * about value ownership.  */
+int val_dict_push_id(struct value_dict *dict, struct value *val, int id);
 
 /* Get NUM-th numbered argument, or NULL if there's not that much
  * arguments.  */
@@ -60,6 +73,10 @@ struct value *val_dict_get_num(struct value_dict *dict, size_t num);
 /* Get argument named NAME, or NULL if there's no such argument.  */
 struct value *val_dict_get_name(struct value_dict *dict, const char *name);
 
+/* Get argument named by identifier ID, or NULL if there's no such
+ * argument.  */
+struct value *val_dict_get_id(struct value_dict *dict, int id);
+
 /* Destroy the dictionary and all the values in it.  Note that DICT
  * itself (the pointer) is not freed.  */
 void val_dict_destroy(struct value_dict *dict);
@@ -19,30 +19,127 @@
  */
 
 #include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "zero.h"
+#include "backend.h"
 #include "common.h"
 #include "type.h"
 #include "value.h"
 #include "expr.h"
 
+/* Chunks of inferior memory that zero_scan_inferior reads start at
+ * ZERO_CHUNK_MIN bytes, most strings are short, and double up to
+ * ZERO_CHUNK_MAX.  */
+#define ZERO_CHUNK_MIN 64
+#define ZERO_CHUNK_MAX 4096
+
+static int
+element_is_zero(const unsigned char *data, size_t size)
+{
+	size_t i;
+	for (i = 0; i < size; ++i)
+		if (data[i] != 0)
+			return 0;
+	return 1;
+}
+
+/* Find the terminating element of the array LHS, which still is in
+ * the inferior, by reading it in chunks that don't cross page
+ * boundaries, instead of one element at a time.  The chunks are
+ * only read up to the page boundary, so that an array that ends
+ * just before an unmapped page can be read as well.  Returns 0 and
+ * sets *RETP to the number of elements before the terminator (or to
+ * MAX), or a negative value if that can't be done.  */
+static int
+zero_scan_inferior(struct value *lhs, size_t max, size_t *retp)
+{
+	struct arg_type_info *elt_type = lhs->type->u.array_info.elt_type;
+	size_t size = type_sizeof(lhs->inferior, elt_type);
+	size_t stride = type_offsetof(lhs->inferior, lhs->type, 1);
+	if (size == (size_t)-1 || stride == (size_t)-1
+	    || size == 0 || size > stride || stride > ZERO_CHUNK_MAX)
+		return -1;
+
+	static size_t page_size = 0;
+	if (page_size == 0) {
+		long ps = sysconf(_SC_PAGESIZE);
+		page_size = ps > 0 ? (size_t)ps : ZERO_CHUNK_MAX;
+	}
+
+	unsigned char buf[ZERO_CHUNK_MAX];
+	size_t chunk = ZERO_CHUNK_MIN;
+	arch_addr_t addr = lhs->u.inf_address;
+	size_t i = 0;
+	while (i < max) {
+		/* Whole elements up to the end of the page, but at
+		 * least one.  */
+		uintptr_t a = (uintptr_t)addr;
+		size_t len = page_size - a % page_size;
+		if (len > chunk)
+			len = chunk;
+		if (chunk < sizeof(buf))
+			chunk *= 2;
+		size_t n = len / stride;
+		if (n == 0)
+			n = 1;
+		if (n > max - i)
+			n = max - i;
+
+		size_t got = umovebytes(lhs->inferior, addr, buf, n * stride);
+		if (got == (size_t)-1 || got < size)
+			return -1;
+
+		size_t k;
+		if (stride == 1) {
+			unsigned char *z = memchr(buf, 0, got);
+			if (z != NULL) {
+				*retp = i + (z - buf);
+				return 0;
+			}
+			k = got;
+		} else {
+			for (k = 0; k * stride + size <= got; ++k)
+				if (element_is_zero(buf + k * stride, size)) {
+					*retp = i + k;
+					return 0;
+				}
+		}
+
+		i += k;
+		addr += k * stride;
+		if (got < n * stride)
+			/* The rest is not readable.  */
+			return -1;
+	}
+
+	*retp = max;
+	return 0;
+}
+
 static int
 zero_callback_max(struct value *ret_value, struct value *lhs,
 		  struct value_dict *arguments,
 		  size_t max, void *data)
 {
 	size_t i;
-	for (i = 0; i < max; ++i) {
-		struct value element;
-		if (value_init_element(&element, lhs, i) < 0)
-			return -1;
+	if (lhs->where != VAL_LOC_INFERIOR
+	    || lhs->type->type != ARGTYPE_ARRAY
+	    || zero_scan_inferior(lhs, max, &i) < 0) {
+		for (i = 0; i < max; ++i) {
+			struct value element;
+			if (value_init_element(&element, lhs, i) < 0)
+				return -1;
 
-		int zero = value_is_zero(&element, arguments);
+			int zero = value_is_zero(&element, arguments);
 
-		value_destroy(&element);
+			value_destroy(&element);
 
-		if (zero)
-			break;
+			if (zero)
+				break;
+		}
 	}
 
 	struct arg_type_info *long_type = type_get_simple(ARGTYPE_LONG);